@@ -1,5 +1,6 @@
 
 from instruction import *
+import sys
 
 """
 Description:
@@ -16,12 +17,17 @@ class Assembler:
 	# dictionary of (key, value) = (label, line number containing label definition)
 	labelsAddressMap                = {}
 	InstObjectToOpcodeMap           = {
-                                        R_Inst:   ["add", "sub", "and", "or", "xor", "sll", "sra"],
-                                        I_Inst:   ["addi", "lw", "jalr"],
-                                        S_Inst:   ["sw"],
-                                        SB_Inst:  ["beq", "bne", "blt", "bge"],
-                                        U_Inst:   ["lui"],
+                                        R_Inst:   ["add", "sub", "and", "or", "xor", "sll", "srl", "sra",
+                                                   "slt", "sltu", "mul", "mulh", "mulhsu", "mulhu",
+                                                   "div", "divu", "rem", "remu"],
+                                        I_Inst:   ["addi", "slti", "sltiu", "xori", "ori", "andi",
+                                                   "slli", "srli", "srai", "lb", "lh", "lw", "lbu",
+                                                   "lhu", "jalr"],
+                                        S_Inst:   ["sb", "sh", "sw"],
+                                        SB_Inst:  ["beq", "bne", "blt", "bge", "bltu", "bgeu"],
+                                        U_Inst:   ["lui", "auipc"],
                                         UJ_Inst:  ["jal"],
+                                        Sys_Inst: ["fence", "ecall", "ebreak"],
                     				  }
 
 	def __init__(self):
@@ -34,8 +40,7 @@ class Assembler:
 	"""
 	def getInstructionObject(self, instruction):
 
-		firstWhitespace = instruction.index(' ')
-		opcode = instruction[:firstWhitespace].lower()
+		opcode = instruction.split()[0].lower()          # some instructions have no operands
 
 		for (instructionObject, listOfOpcodes) in self.InstObjectToOpcodeMap.items():
 			if opcode in listOfOpcodes:
@@ -130,6 +135,17 @@ class Assembler:
 			print(binaryInstruction)
 
 
+	"""
+	write every label with its address, one "<hex address> <label>" per line,
+	for the simulator's profiler (--symbols)
+	"""
+	def printSymbols(self, path):
+
+		with open(path, "w") as symbols:
+			for (label, instructionCounter) in self.labelsAddressMap.items():
+				symbols.write("%08x %s\n" % (instructionCounter * SizeOfInstruction, label))
+
+
 	def runAssembler(self):
 
 		self.performPass1()
@@ -141,3 +157,7 @@ if __name__ == "__main__":
 	a = Assembler()
 	a.runAssembler()
 	a.printBinary()
+
+	for argument in sys.argv[1:]:
+		if argument.startswith("--symbols="):
+			a.printSymbols(argument[len("--symbols="):])
@@ -128,7 +128,7 @@ class Instruction:
 	"""
 	def separateOffsetFromSourceRegister(self, idx):
 
-		if self.opcode in ["sw", "lw"]:
+		if self.opcode in ["sw", "sh", "sb", "lw", "lh", "lhu", "lb", "lbu"]:
 			# registerWithOffset = "offset(rs1)""
 			registerWithOffset = self.tokensOfInstruction[idx]
 			length = len(registerWithOffset)
@@ -165,7 +165,9 @@ class Instruction:
 Parent class: Instruction
 Instruction of R-format type
 	- R-format type: instructions using 3 register inputs
-	- deals with opcodes: ["add", "sub", "and", "or", "xor", "sll", "sra"]
+	- deals with opcodes: ["add", "sub", "and", "or", "xor", "sll", "srl", "sra",
+	                       "slt", "sltu"] and the M extension: ["mul", "mulh",
+	                       "mulhsu", "mulhu", "div", "divu", "rem", "remu"]
 Example: 			opcode rd rs1 rs2
 binaryInstruction:	funct7 | rs2 | rs1 | funct3 | rd | opcode
 """
@@ -202,39 +204,51 @@ class R_Inst(Instruction):
 		self.debugInstruction()
 
 
+	# (funct3, funct7) of every opcode
+	functs = {
+				"add":    ("000", "0000000"),
+				"sub":    ("000", "0100000"),
+				"sll":    ("001", "0000000"),
+				"slt":    ("010", "0000000"),
+				"sltu":   ("011", "0000000"),
+				"xor":    ("100", "0000000"),
+				"srl":    ("101", "0000000"),
+				"sra":    ("101", "0100000"),
+				"or":     ("110", "0000000"),
+				"and":    ("111", "0000000"),
+				"mul":    ("000", "0000001"),
+				"mulh":   ("001", "0000001"),
+				"mulhsu": ("010", "0000001"),
+				"mulhu":  ("011", "0000001"),
+				"div":    ("100", "0000001"),
+				"divu":   ("101", "0000001"),
+				"rem":    ("110", "0000001"),
+				"remu":   ("111", "0000001"),
+			 }
+
+
 	def getOpcodeInBinary(self):
-		return "0110011"								# add, sub, and, or, xor, sll, sra: all have same opcode
+		return "0110011"								# all R-format instructions have same opcode
 
 
 	def getFunct3(self):
-
-		if self.opcode in ["add", "sub"]:
-			return "000"
-		elif self.opcode == "and":
-			return "111"
-		elif self.opcode == "or":
-			return "110"
-		elif self.opcode == "xor":
-			return "100"
-		elif self.opcode == "sll":
-			return "001"
-		elif self.opcode == "sra":
-			return "101"
-		else:
+		if self.opcode not in self.functs:
 			raise Exception("Unknown Opcode: " + self.instruction)
+		return self.functs[self.opcode][0]
 
 
 	def getFunct7(self):
-		if self.opcode in ["add", "sll", "xor", "or", "and"]:
-			return "0" * 7
-		else:
-			return "0100000"                            # sub, sra
+		return self.functs[self.opcode][1]
 
 """
 Parent class: Instruction
 Instruction of I-format type
 	- I-format type: instructions with immediates and load
-	- deals with opcodes: ["addi", "lw", "jalr"]
+	- deals with opcodes: ["addi", "slti", "sltiu", "xori", "ori", "andi",
+	                       "slli", "srli", "srai", "lb", "lh", "lw", "lbu", "lhu",
+	                       "jalr"]
+	- shifts take a 5-bit shift amount, the upper 7 bits of their immediate
+	  hold funct7
 Example: 			opcode rd rs1 immediate
 binaryInstruction:	immediate | rs1 | funct3 | rd | opcode
 """
@@ -254,7 +268,11 @@ class I_Inst(Instruction):
 		self.rd         = self.getRegisterInBinary(self.tokensOfInstruction[1])
 		self.rs1        = self.getRegisterInBinary(self.tokensOfInstruction[2])
 		self.funct3     = self.getFunct3()
-		self.immediate  = self.getImmediateInBinary(self.tokensOfInstruction[3], 12)
+		if self.opcode in self.shiftFunct7:
+			self.immediate = self.shiftFunct7[self.opcode] \
+							 + self.getImmediateInBinary(self.tokensOfInstruction[3], 5)
+		else:
+			self.immediate = self.getImmediateInBinary(self.tokensOfInstruction[3], 12)
 
 		self.binaryInstruction = self.immediate + self.rs1 + self.funct3       \
 								 + self.rd + self.opcodeInBinary
@@ -270,24 +288,36 @@ class I_Inst(Instruction):
 		self.debugInstruction()
 
 
+	# (opcode, funct3) of every opcode
+	codes = {
+				"addi":  ("0010011", "000"),
+				"slti":  ("0010011", "010"),
+				"sltiu": ("0010011", "011"),
+				"xori":  ("0010011", "100"),
+				"ori":   ("0010011", "110"),
+				"andi":  ("0010011", "111"),
+				"slli":  ("0010011", "001"),
+				"srli":  ("0010011", "101"),
+				"srai":  ("0010011", "101"),
+				"lb":    ("0000011", "000"),
+				"lh":    ("0000011", "001"),
+				"lw":    ("0000011", "010"),
+				"lbu":   ("0000011", "100"),
+				"lhu":   ("0000011", "101"),
+				"jalr":  ("1100111", "000"),
+			}
+
+	shiftFunct7 = {"slli": "0000000", "srli": "0000000", "srai": "0100000"}
+
+
 	def getOpcodeInBinary(self):
-		if self.opcode == "addi":
-			return "0010011"
-		elif self.opcode == "lw":
-			return "0000011"
-		elif self.opcode == "jalr":
-			return "1100111"
-		else:
+		if self.opcode not in self.codes:
 			raise Exception("Unknown Opcode: " + self.instruction)
+		return self.codes[self.opcode][0]
 
 
 	def getFunct3(self):
-		if self.opcode in ["addi", "jalr"]:
-			return "000"
-		elif self.opcode == "lw":
-			return "010"
-		else:
-			raise Exception("Unknown Opcode: " + self.instruction)
+		return self.codes[self.opcode][1]
 
 
 
@@ -295,7 +325,7 @@ class I_Inst(Instruction):
 Parent class: Instruction
 Instruction of S-format type
 	- S-format type: store instructions 
-	- deals with opcodes: ["sw"]
+	- deals with opcodes: ["sb", "sh", "sw"]
 Example: 			opcode rs2 immediate(rs1) 
 binaryInstruction:	immediate_7 | rs2 | rs1 | funct3 | immediate_5 | opcode
 """
@@ -311,7 +341,7 @@ class S_Inst(Instruction):
 
 		super().__init__(instruction)
 
-		self.separateOffsetFromSourceRegister(-1)        # for sw
+		self.separateOffsetFromSourceRegister(-1)        # for sb, sh, sw
 
 		self.rs1         = self.getRegisterInBinary(self.tokensOfInstruction[2])
 		self.rs2         = self.getRegisterInBinary(self.tokensOfInstruction[1])
@@ -337,21 +367,26 @@ class S_Inst(Instruction):
 
 
 	def getOpcodeInBinary(self):
-		if self.opcode == "sw":
+		if self.opcode in ["sb", "sh", "sw"]:
 			return "0100011"
 		else:
 			raise Exception("Unknown Opcode: " + self.instruction)
 
 
 	def getFunct3(self):
-		return "010"                                      # for sw
+		if self.opcode == "sb":
+			return "000"
+		elif self.opcode == "sh":
+			return "001"
+		else:
+			return "010"                                  # for sw
 
 
 """
 Parent class: Instruction
 Instruction of SB-format type
 	- SB-format type: branch instructions 
-	- deals with opcodes: ["beq", "bne", "blt", "bge"]
+	- deals with opcodes: ["beq", "bne", "blt", "bge", "bltu", "bgeu"]
 Example: 			opcode rs2 rs2 offset 
 binaryInstruction:	immediate_7 | rs2 | rs1 | funct3 | immediate_5 | opcode
 """
@@ -375,7 +410,7 @@ class SB_Inst(Instruction):
 
 
 	def getOpcodeInBinary(self):
-		return "1100011"                                # beq, bne, blt, bge
+		return "1100011"                                # beq, bne, blt, bge, bltu, bgeu
 
 
 	def getFunct3(self):
@@ -387,6 +422,10 @@ class SB_Inst(Instruction):
 			return "100"
 		elif self.opcode == "bge":
 			return "101"
+		elif self.opcode == "bltu":
+			return "110"
+		elif self.opcode == "bgeu":
+			return "111"
 		else:
 			raise Exception("Unknown Opcode: " + self.instruction)
 
@@ -439,7 +478,7 @@ class SB_Inst(Instruction):
 Parent class: Instruction
 Instruction of U-format type
 	- U-format type: instructions with upper immediates
-	- deals with opcodes: ["lui"]
+	- deals with opcodes: ["lui", "auipc"]
 Example: 			opcode rd immediate 
 binaryInstruction:	immediate | rd | opcode
 """
@@ -467,7 +506,12 @@ class U_Inst(Instruction):
 
 
 	def getOpcodeInBinary(self):
-		return "0110111"                                # for lui
+		if self.opcode == "lui":
+			return "0110111"
+		elif self.opcode == "auipc":
+			return "0010111"
+		else:
+			raise Exception("Unknown Opcode: " + self.instruction)
 
 """
 Parent class: Instruction
@@ -532,3 +576,37 @@ class UJ_Inst(Instruction):
 							 "opcodeInBinary":self.opcodeInBinary  ,
 							 }
 		self.debugInstruction()
+
+
+
+"""
+Parent class: Instruction
+Instructions without operands
+	- deals with opcodes: ["fence", "ecall", "ebreak"]
+	- fence orders all memory accesses (pred = succ = iorw)
+Example: 			opcode
+binaryInstruction:	fixed 32 bit encoding
+"""
+class Sys_Inst(Instruction):
+
+	encodings = {
+					"fence":  "00001111111100000000000000001111",
+					"ecall":  "00000000000000000000000001110011",
+					"ebreak": "00000000000100000000000001110011",
+				}
+
+	def __init__(self, instruction):
+
+		super().__init__(instruction)
+
+		self.binaryInstruction = self.encodings[self.opcode]
+
+		# For debugging only
+		self.dictOfFields = {"opcodeInBinary":self.opcodeInBinary}
+		self.debugInstruction()
+
+
+	def getOpcodeInBinary(self):
+		if self.opcode not in self.encodings:
+			raise Exception("Unknown Opcode: " + self.instruction)
+		return self.encodings[self.opcode][25:]
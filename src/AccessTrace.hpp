@@ -0,0 +1,46 @@
+#ifndef __ACCESS_TRACE_H
+#define __ACCESS_TRACE_H
+
+#include "common.hpp"
+#include <cstdint> // for std::uint8_t
+#include <vector>  // for std::vector
+
+enum class AccessKind : std::uint8_t { Fetch, Load, Store };
+
+struct Access {
+  Word address;
+  // value written by a store, 0 otherwise
+  Word value;
+  AccessKind kind;
+};
+
+// Receives every access the memory subsystem makes while it is set as its
+// recorder, along with the cycles the access took.
+class AccessRecorder {
+public:
+  virtual ~AccessRecorder() = default;
+  virtual void record(const AccessKind kind, const Word address, const Word value,
+                      const Cycle t) = 0;
+};
+
+// The stream of memory accesses a program made, in program order, as seen by
+// the memory subsystem. Replaying it against other cache configurations gives
+// their timing without executing the program again.
+class AccessTrace final : public AccessRecorder {
+  std::vector<Access> accesses;
+  // cycles the recorded accesses took in the run that made the trace
+  Cycle memory_cycles = 0;
+
+public:
+  void record(const AccessKind kind, const Word address, const Word value,
+              const Cycle t) override {
+    accesses.push_back({address, value, kind});
+    memory_cycles += t;
+  }
+
+  const std::vector<Access> &getAccesses() const { return accesses; }
+
+  Cycle getMemoryCycles() const { return memory_cycles; }
+};
+
+#endif /* end of __ACCESS_TRACE_H */
@@ -0,0 +1,163 @@
+#include "AccessTraceFile.hpp"
+#include "Sweep.hpp"
+#include <algorithm> // for std::fill
+#include <cstring>   // for std::memcmp
+
+namespace {
+
+enum : std::uint8_t {
+  // low bits of the tag hold the kind
+  kind_mask = 0b11,
+  // the address delta is that of the previous access of the kind
+  repeat_delta = 0b100,
+};
+
+void putVarint(std::vector<std::uint8_t> &out, Word value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<std::uint8_t>(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<std::uint8_t>(value));
+}
+
+Word getVarint(const std::uint8_t *&in, const std::uint8_t *end) {
+  Word value = 0;
+  for (unsigned shift = 0; shift < XLEN; shift += 7) {
+    if (in == end)
+      throw std::runtime_error("corrupt access trace");
+    const std::uint8_t byte = *in++;
+    value |= static_cast<Word>(byte & 0x7f) << shift;
+    if (not(byte & 0x80))
+      return value;
+  }
+  throw std::runtime_error("corrupt access trace");
+}
+
+// small deltas either way become small varints
+Word zigzag(const Word delta) {
+  return delta << 1 ^ static_cast<Word>(static_cast<SignedWord>(delta) >> (XLEN - 1));
+}
+Word unzigzag(const Word value) { return value >> 1 ^ (0 - (value & 1)); }
+
+} // namespace
+
+AccessTraceWriter::AccessTraceWriter(const std::string &path)
+    : file(std::fopen(path.c_str(), "wb"), &std::fclose) {
+  if (not file)
+    throw std::runtime_error("cannot open access trace '" + path + "'");
+  std::fwrite(access_trace_magic, sizeof(access_trace_magic), 1, file.get());
+  std::fwrite(&access_trace_version, sizeof(access_trace_version), 1, file.get());
+}
+
+AccessTraceWriter::~AccessTraceWriter() {
+  try {
+    if (file)
+      close(0);
+  } catch (std::exception &) {
+    // nobody is left to tell
+  }
+}
+
+void AccessTraceWriter::record(const AccessKind kind, const Word address, const Word value,
+                               const Cycle t) {
+  const auto k = static_cast<std::uint8_t>(kind);
+  const Word delta = address - last_address[k];
+  last_address[k] = address;
+  if (delta == last_delta[k]) {
+    block.push_back(k | repeat_delta);
+  } else {
+    block.push_back(k);
+    putVarint(block, zigzag(delta));
+    last_delta[k] = delta;
+  }
+  if (kind == AccessKind::Store)
+    putVarint(block, value);
+
+  ++footer.accesses;
+  footer.memory_cycles += t;
+  if (++block_count == block_accesses)
+    flush();
+}
+
+void AccessTraceWriter::flush() {
+  const std::uint32_t bytes = block.size();
+  std::fwrite(&block_count, sizeof(block_count), 1, file.get());
+  std::fwrite(&bytes, sizeof(bytes), 1, file.get());
+  std::fwrite(block.data(), 1, block.size(), file.get());
+  block.clear();
+  block_count = 0;
+  std::fill(std::begin(last_address), std::end(last_address), 0);
+  std::fill(std::begin(last_delta), std::end(last_delta), 0);
+}
+
+void AccessTraceWriter::close(const Cycle base_cycles) {
+  if (block_count > 0)
+    flush();
+  // the empty block ending the trace
+  flush();
+  footer.base_cycles = base_cycles;
+  std::fwrite(&footer, sizeof(footer), 1, file.get());
+  const bool failed = std::ferror(file.get());
+  file.reset();
+  if (failed)
+    throw std::runtime_error("cannot write access trace");
+}
+
+AccessTraceReader::AccessTraceReader(const std::string &path)
+    : file(std::fopen(path.c_str(), "rb"), &std::fclose) {
+  if (not file)
+    throw std::runtime_error("cannot open access trace '" + path + "'");
+  char magic[sizeof(access_trace_magic)];
+  std::uint32_t version;
+  if (std::fread(magic, sizeof(magic), 1, file.get()) != 1 or
+      std::memcmp(magic, access_trace_magic, sizeof(magic)) != 0)
+    throw std::runtime_error("'" + path + "' is not an access trace");
+  if (std::fread(&version, sizeof(version), 1, file.get()) != 1 or
+      version != access_trace_version)
+    throw std::runtime_error("unsupported access trace version");
+}
+
+bool AccessTraceReader::next(std::vector<Access> &accesses) {
+  accesses.clear();
+  std::uint32_t count, bytes;
+  if (std::fread(&count, sizeof(count), 1, file.get()) != 1 or
+      std::fread(&bytes, sizeof(bytes), 1, file.get()) != 1)
+    throw std::runtime_error("truncated access trace");
+  if (count == 0) {
+    if (std::fread(&footer, sizeof(footer), 1, file.get()) != 1)
+      throw std::runtime_error("truncated access trace");
+    return false;
+  }
+  block.resize(bytes);
+  if (std::fread(block.data(), 1, bytes, file.get()) != bytes)
+    throw std::runtime_error("truncated access trace");
+
+  Word last_address[3] = {}, last_delta[3] = {};
+  accesses.reserve(count);
+  const std::uint8_t *in = block.data(), *end = in + block.size();
+  for (std::uint32_t i = 0; i < count; ++i) {
+    if (in == end)
+      throw std::runtime_error("corrupt access trace");
+    const std::uint8_t tag = *in++;
+    const std::uint8_t k = tag & kind_mask;
+    if (k > static_cast<std::uint8_t>(AccessKind::Store))
+      throw std::runtime_error("corrupt access trace");
+    if (not(tag & repeat_delta))
+      last_delta[k] = unzigzag(getVarint(in, end));
+    last_address[k] += last_delta[k];
+    const auto kind = static_cast<AccessKind>(k);
+    accesses.push_back(
+        {last_address[k], kind == AccessKind::Store ? getVarint(in, end) : 0, kind});
+  }
+  return true;
+}
+
+ReplayResult replayTrace(const std::string &path, Memory &memory) {
+  AccessTraceReader reader(path);
+  ReplayResult result;
+  std::vector<Access> accesses;
+  while (reader.next(accesses))
+    result.memory_cycles += replayAccesses(accesses, memory);
+  result.recorded = reader.getFooter();
+  return result;
+}
@@ -0,0 +1,91 @@
+#ifndef __ACCESS_TRACE_FILE_H
+#define __ACCESS_TRACE_FILE_H
+
+#include "Memory.hpp"
+#include <cstdio> // for std::FILE
+#include <memory> // for std::unique_ptr
+#include <string>
+#include <vector> // for std::vector
+
+// On disk an access trace is a header followed by independently decodable
+// blocks, each a record count and a byte length followed by that many bytes
+// of encoded accesses. An empty block ends the trace and is followed by a
+// footer.
+//
+// Every access starts with a tag byte holding its kind. Addresses are delta
+// encoded against the previous access of the same kind: if the delta repeats
+// the previous one of that kind (sequential fetches, strided loads) the tag
+// says so and nothing follows, otherwise the delta follows as a zigzag
+// varint. Stores are followed by their value as a varint. Deltas restart at
+// every block.
+constexpr char access_trace_magic[8] = {'R', 'V', 'A', 'C', 'C', 'E', 'S', 'S'};
+constexpr std::uint32_t access_trace_version = 1;
+
+struct AccessTraceFooter {
+  std::uint64_t accesses = 0;
+  // cycles the accesses took in the recorded run, and the cycles of the run
+  // spent outside the memory subsystem
+  Cycle memory_cycles = 0, base_cycles = 0;
+};
+
+// Streams the accesses it is handed to a file, a block at a time.
+class AccessTraceWriter final : public AccessRecorder {
+
+  static constexpr std::uint32_t block_accesses = 1u << 16;
+
+  std::unique_ptr<std::FILE, int (*)(std::FILE *)> file;
+  std::vector<std::uint8_t> block;
+  std::uint32_t block_count = 0;
+  // delta state of every kind
+  Word last_address[3] = {}, last_delta[3] = {};
+  AccessTraceFooter footer;
+
+  void flush();
+
+public:
+  AccessTraceWriter(const std::string &path);
+  // closes the trace with no base cycles if close was not called
+  ~AccessTraceWriter();
+
+  AccessTraceWriter(const AccessTraceWriter &) = delete;
+  AccessTraceWriter(AccessTraceWriter &&) = delete;
+
+  void record(const AccessKind kind, const Word address, const Word value,
+              const Cycle t) override;
+
+  Cycle getMemoryCycles() const { return footer.memory_cycles; }
+
+  // writes the last block and the footer; base_cycles are the cycles of the
+  // run not spent in the memory subsystem
+  void close(const Cycle base_cycles);
+};
+
+// Reads an access trace back a block at a time.
+class AccessTraceReader final {
+
+  std::unique_ptr<std::FILE, int (*)(std::FILE *)> file;
+  std::vector<std::uint8_t> block;
+  AccessTraceFooter footer;
+
+public:
+  AccessTraceReader(const std::string &path);
+
+  // replaces accesses with those of the next block, returning false once
+  // the trace has ended
+  bool next(std::vector<Access> &accesses);
+
+  // only valid once next returned false
+  const AccessTraceFooter &getFooter() const { return footer; }
+};
+
+struct ReplayResult {
+  AccessTraceFooter recorded;
+  // cycles the accesses took against the memory subsystem replayed into
+  Cycle memory_cycles = 0;
+};
+
+// Feeds every access of the trace file to the memory subsystem, streaming it
+// so that traces much larger than memory can be replayed.
+ReplayResult replayTrace(const std::string &path, Memory &memory);
+
+#endif /* end of __ACCESS_TRACE_FILE_H */
@@ -0,0 +1,166 @@
+#include "Batch.hpp"
+#include "WorkStealingPool.hpp"
+#include <fstream> // for reading manifests
+#include <sstream> // for splitting manifest lines
+
+namespace {
+
+struct Job {
+  unsigned line;
+  std::vector<std::string> arguments;
+};
+
+std::vector<Job> readManifest(const std::string &path) {
+  std::ifstream file(path);
+  if (not file)
+    throw std::runtime_error("cannot open manifest '" + path + "'");
+
+  std::vector<Job> jobs;
+  unsigned line_number = 0;
+  for (std::string line; std::getline(file, line);) {
+    ++line_number;
+    Job job{line_number, {}};
+    std::istringstream words(line);
+    for (std::string word; words >> word;)
+      job.arguments.push_back(word);
+    if (job.arguments.empty() or job.arguments[0][0] == '#')
+      continue;
+    jobs.push_back(std::move(job));
+  }
+  return jobs;
+}
+
+JobResult runJob(const Job &job, const std::vector<std::string> &base_arguments) {
+  JobResult result;
+  result.line = job.line;
+  try {
+    Options options;
+    for (const std::string &arg : base_arguments)
+      parseArgument(arg, options);
+    for (const std::string &arg : job.arguments) {
+      parseArgument(arg, options);
+      // the program is reported on its own
+      result.binary_path = options.binary_path;
+      if (arg != options.binary_path)
+        result.arguments += (result.arguments.empty() ? "" : " ") + arg;
+    }
+    if (options.binary_path.empty() and options.restore_path.empty())
+      throw std::runtime_error("no program given");
+    if (options.multi_hart or not options.sweep_grid.empty() or options.miss_curve_grid or
+        not options.batch_path.empty() or not options.checkpoint_path.empty() or options.sampling or
+        not options.access_trace_path.empty() or not options.replay_path.empty())
+      throw std::runtime_error("batch jobs run one program on one hart");
+    finishOptions(options);
+    options.config.trace_level = TraceLevel::None;
+
+    MainMemory mainMemory{100, options.memory_size};
+    std::optional<CacheHierarchy> caches;
+    std::optional<Memory> memory;
+    if (options.no_cache) {
+      memory.emplace(&mainMemory);
+    } else {
+      caches.emplace(options.hierarchy, &mainMemory);
+      memory.emplace(&mainMemory, *caches);
+    }
+
+    Simulation sim{*memory, options.binary_path, options.config};
+    if (options.restore_path.empty()) {
+      result.cycles = sim.simulate();
+    } else {
+      std::ifstream checkpoint(options.restore_path, std::ios::binary);
+      if (not checkpoint)
+        throw std::runtime_error("cannot read checkpoint '" + options.restore_path + "'");
+      sim.restoreCheckpoint(checkpoint);
+      result.cycles = sim.resume();
+    }
+    if (caches)
+      for (Cache *cache : caches->levels())
+        result.caches.emplace_back(cache->getName(), cache->getStats());
+  } catch (std::exception &e) {
+    result.error = e.what();
+    // every option of the line, including the one that failed; without a
+    // program the whole line
+    result.arguments.clear();
+    for (const std::string &arg : job.arguments)
+      if (arg != result.binary_path)
+        result.arguments += (result.arguments.empty() ? "" : " ") + arg;
+  }
+  return result;
+}
+
+std::string jsonString(const std::string &s) {
+  std::ostringstream os;
+  os << '"';
+  for (const char c : s) {
+    if (c == '"' or c == '\\')
+      os << '\\' << c;
+    else if (static_cast<unsigned char>(c) < 0x20)
+      os << "\\u" << std::hex << std::setw(4) << std::setfill('0') << int(c) << std::dec;
+    else
+      os << c;
+  }
+  os << '"';
+  return os.str();
+}
+
+std::string csvField(const std::string &s) {
+  if (s.find_first_of(",\"\n") == std::string::npos)
+    return s;
+  std::string quoted = "\"";
+  for (const char c : s)
+    quoted += c == '"' ? std::string("\"\"") : std::string(1, c);
+  return quoted + "\"";
+}
+
+} // namespace
+
+std::vector<JobResult> runBatch(const std::string &path,
+                                const std::vector<std::string> &base_arguments,
+                                const unsigned threads) {
+  const std::vector<Job> jobs = readManifest(path);
+  std::vector<JobResult> results(jobs.size());
+
+  WorkStealingPool pool(threads);
+  for (std::size_t i = 0; i < jobs.size(); ++i)
+    pool.submit([&, i]() { results[i] = runJob(jobs[i], base_arguments); });
+  pool.run();
+  return results;
+}
+
+void writeReport(std::ostream &os, const std::vector<JobResult> &results, const bool csv) {
+  if (csv) {
+    os << "line,binary,arguments,status,error,cycles,cache,hits,misses,access_cycles\n";
+    for (const JobResult &r : results) {
+      const std::string job = std::to_string(r.line) + "," + csvField(r.binary_path) + "," +
+                              csvField(r.arguments) + "," + (r.error.empty() ? "ok" : "error") +
+                              "," + csvField(r.error) + "," + std::to_string(r.cycles) + ",";
+      if (r.caches.empty())
+        os << job << ",,,\n";
+      for (const auto &[name, stats] : r.caches)
+        os << job << csvField(name) << "," << stats.hits << "," << stats.misses << ","
+           << stats.cycles << "\n";
+    }
+    return;
+  }
+
+  std::size_t failed = 0;
+  os << "{\n  \"jobs\": [";
+  for (std::size_t i = 0; i < results.size(); ++i) {
+    const JobResult &r = results[i];
+    failed += not r.error.empty();
+    os << (i ? "," : "") << "\n    {\"line\": " << r.line
+       << ", \"binary\": " << jsonString(r.binary_path)
+       << ", \"arguments\": " << jsonString(r.arguments)
+       << ", \"status\": " << (r.error.empty() ? "\"ok\"" : "\"error\"");
+    if (not r.error.empty())
+      os << ", \"error\": " << jsonString(r.error);
+    os << ", \"cycles\": " << r.cycles << ", \"caches\": [";
+    for (std::size_t j = 0; j < r.caches.size(); ++j) {
+      const auto &[name, stats] = r.caches[j];
+      os << (j ? ", " : "") << "{\"name\": " << jsonString(name) << ", \"hits\": " << stats.hits
+         << ", \"misses\": " << stats.misses << ", \"cycles\": " << stats.cycles << "}";
+    }
+    os << "]}";
+  }
+  os << "\n  ],\n  \"total\": " << results.size() << ",\n  \"failed\": " << failed << "\n}\n";
+}
@@ -0,0 +1,34 @@
+#ifndef __BATCH_H
+#define __BATCH_H
+
+#include "Options.hpp"
+#include <string>
+#include <utility> // for std::pair
+#include <vector>  // for std::vector
+
+struct JobResult {
+  // line of the job in the manifest
+  unsigned line = 0;
+  std::string binary_path;
+  // the job's own options, as written in the manifest
+  std::string arguments;
+  // empty if the job ran to completion
+  std::string error;
+  Cycle cycles = 0;
+  // statistics of every cache level, closest to the CPU first
+  std::vector<std::pair<std::string, CacheStats>> caches;
+};
+
+// Runs every job of the manifest at path on a work-stealing pool of threads
+// (0 for one per hardware thread). A manifest lists one job per line: a
+// program followed by options, which apply on top of base_arguments; blank
+// lines and lines starting with # are skipped. Jobs print nothing, results
+// are returned in manifest order.
+std::vector<JobResult> runBatch(const std::string &path,
+                                const std::vector<std::string> &base_arguments,
+                                const unsigned threads = 0);
+
+// Reports the results as JSON, or CSV with one row per job and cache level.
+void writeReport(std::ostream &os, const std::vector<JobResult> &results, const bool csv);
+
+#endif /* end of __BATCH_H */
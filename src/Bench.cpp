@@ -0,0 +1,513 @@
+/* Microbenchmarks of the simulator itself, for catching throughput
+ * regressions.
+ *
+ * Synthetic kernels run on both execution engines and are measured in
+ * simulated MIPS, every cache policy and associativity in accesses per second
+ * of getData and writeData, and main memory in block transfer throughput.
+ * Results are written as CSV; given an earlier result file as a baseline, the
+ * run fails if any benchmark got slower by more than a tolerance.
+ */
+#include "Options.hpp"
+#include <chrono>  // for std::chrono::steady_clock
+#include <fstream> // for result files
+#include <map>     // for std::map
+#include <random>  // for std::mt19937
+#include <sstream> // for parsing result files
+
+namespace {
+
+// Builds RV32IM programs for the kernels, encoding only the instructions they
+// use.
+class CodeBuilder final {
+  std::vector<Instruction> code;
+
+  void R(const Word funct7, const Word funct3, const Word rd, const Word rs1, const Word rs2) {
+    code.push_back(funct7 << 25 | rs2 << 20 | rs1 << 15 | funct3 << 12 | rd << 7 | 0x33);
+  }
+
+  void I(const Word opcode, const Word funct3, const Word rd, const Word rs1, const Word imm) {
+    code.push_back((imm & 0xfff) << 20 | rs1 << 15 | funct3 << 12 | rd << 7 | opcode);
+  }
+
+  static Instruction B(const Word funct3, const Word rs1, const Word rs2, const Word offset) {
+    return ((offset >> 12) & 1) << 31 | ((offset >> 5) & 0x3f) << 25 | rs2 << 20 | rs1 << 15 |
+           funct3 << 12 | ((offset >> 1) & 0xf) << 8 | ((offset >> 11) & 1) << 7 | 0x63;
+  }
+
+public:
+  static constexpr Word BEQ = 0, BNE = 1;
+
+  Word here() const { return 4 * code.size(); }
+  const std::vector<Instruction> &getCode() const { return code; }
+
+  void add(Word rd, Word rs1, Word rs2) { R(0x00, 0, rd, rs1, rs2); }
+  void sll(Word rd, Word rs1, Word rs2) { R(0x00, 1, rd, rs1, rs2); }
+  void xor_(Word rd, Word rs1, Word rs2) { R(0x00, 4, rd, rs1, rs2); }
+  void sra(Word rd, Word rs1, Word rs2) { R(0x20, 5, rd, rs1, rs2); }
+  void and_(Word rd, Word rs1, Word rs2) { R(0x00, 7, rd, rs1, rs2); }
+  void mul(Word rd, Word rs1, Word rs2) { R(0x01, 0, rd, rs1, rs2); }
+  void addi(Word rd, Word rs1, Word imm) { I(0x13, 0, rd, rs1, imm); }
+  void lw(Word rd, Word rs1, Word imm) { I(0x03, 2, rd, rs1, imm); }
+  void sw(Word rs2, Word rs1, Word imm) {
+    code.push_back(((imm >> 5) & 0x7f) << 25 | rs2 << 20 | rs1 << 15 | 2 << 12 |
+                   (imm & 0x1f) << 7 | 0x23);
+  }
+
+  // loads any 32-bit value, as lui and a sign-extended addi
+  void li(Word rd, Word value) {
+    const Word upper = (value + 0x800) & 0xfffff000;
+    code.push_back(upper | rd << 7 | 0x37);
+    addi(rd, rd, value - upper);
+  }
+
+  // branch to an address already emitted
+  void branch(Word funct3, Word rs1, Word rs2, Word target) {
+    code.push_back(B(funct3, rs1, rs2, target - here()));
+  }
+
+  // branch to an address emitted later, given to patch
+  std::size_t branchForward(Word funct3, Word rs1, Word rs2) {
+    code.push_back(B(funct3, rs1, rs2, 0));
+    return code.size() - 1;
+  }
+  void patch(std::size_t at, Word target) {
+    code[at] |= B(0, 0, 0, target - 4 * at);
+  }
+};
+
+// kernels keep their data here, clear of the code
+constexpr Word data_address = 0x2000;
+// main memory of the kernels, in terms of Word
+constexpr Word kernel_memory = 16384;
+
+struct Kernel {
+  std::string name;
+  std::vector<Instruction> code;
+  // initial data words by address
+  std::vector<std::pair<Word, Word>> data;
+  // the register the kernel leaves its result in, checked against expected
+  // so that the benchmark cannot silently measure a broken simulator
+  Word result_register;
+  Word expected;
+};
+
+// follows a random cyclic list, every load depends on the previous one
+Kernel pointerChase() {
+  constexpr Word nodes = 4096, steps = 1 << 18;
+  std::vector<Word> order(nodes);
+  for (Word i = 0; i < nodes; ++i)
+    order[i] = i;
+  std::shuffle(order.begin() + 1, order.end(), std::mt19937(1));
+
+  Kernel k{"chase", {}, {}, 1, data_address + 4 * order[steps % nodes]};
+  for (Word i = 0; i < nodes; ++i)
+    k.data.emplace_back(data_address + 4 * order[i], data_address + 4 * order[(i + 1) % nodes]);
+
+  CodeBuilder c;
+  c.li(1, data_address + 4 * order[0]);
+  c.li(2, steps);
+  const Word loop = c.here();
+  c.lw(1, 1, 0);
+  c.addi(2, 2, -1);
+  c.branch(CodeBuilder::BNE, 2, 0, loop);
+  k.code = c.getCode();
+  return k;
+}
+
+// reads, accumulates and writes back an array sequentially, pass after pass
+Kernel streaming() {
+  constexpr Word words = 4096, passes = 16;
+  Kernel k{"stream", {}, {}, 6, 0};
+  std::vector<Word> a(words);
+  for (Word i = 0; i < words; ++i) {
+    a[i] = i;
+    k.data.emplace_back(data_address + 4 * i, i);
+  }
+  for (Word pass = 0; pass < passes; ++pass)
+    for (Word i = 0; i < words; ++i)
+      a[i] = k.expected += a[i];
+
+  CodeBuilder c;
+  c.li(3, passes);
+  const Word outer = c.here();
+  c.li(1, data_address);
+  c.li(4, data_address + 4 * words);
+  const Word inner = c.here();
+  c.lw(5, 1, 0);
+  c.add(6, 6, 5);
+  c.sw(6, 1, 0);
+  c.addi(1, 1, 4);
+  c.branch(CodeBuilder::BNE, 1, 4, inner);
+  c.addi(3, 3, -1);
+  c.branch(CodeBuilder::BNE, 3, 0, outer);
+  k.code = c.getCode();
+  return k;
+}
+
+// C = A * B of n x n matrices; the result is the sum of C
+Kernel matmul() {
+  constexpr Word n = 12, repetitions = 8;
+  const Word A = data_address, B = A + 4 * n * n, C = B + 4 * n * n;
+  Kernel k{"matmul", {}, {}, 26, 0};
+  for (Word i = 0; i < n * n; ++i) {
+    k.data.emplace_back(A + 4 * i, i % 5);
+    k.data.emplace_back(B + 4 * i, i * 3 % 7);
+  }
+  for (Word i = 0; i < n; ++i)
+    for (Word j = 0; j < n; ++j)
+      for (Word x = 0; x < n; ++x)
+        k.expected += (i * n + x) % 5 * ((x * n + j) * 3 % 7);
+
+  CodeBuilder c;
+  c.li(13, n);
+  c.li(25, 4 * n);
+  c.li(27, repetitions);
+  const Word repeat = c.here();
+  c.li(20, A); // row of A
+  c.li(21, C); // element of C
+  c.li(10, 0); // i
+  const Word row = c.here();
+  c.li(11, 0); // j
+  c.li(22, B); // column of B
+  const Word column = c.here();
+  c.addi(23, 20, 0);
+  c.addi(24, 22, 0);
+  c.addi(12, 13, 0); // remaining k
+  c.li(15, 0);
+  const Word element = c.here();
+  c.lw(16, 23, 0);
+  c.lw(17, 24, 0);
+  c.mul(16, 16, 17);
+  c.add(15, 15, 16);
+  c.addi(23, 23, 4);
+  c.add(24, 24, 25);
+  c.addi(12, 12, -1);
+  c.branch(CodeBuilder::BNE, 12, 0, element);
+  c.sw(15, 21, 0);
+  c.addi(21, 21, 4);
+  c.addi(22, 22, 4);
+  c.addi(11, 11, 1);
+  c.branch(CodeBuilder::BNE, 11, 13, column);
+  c.add(20, 20, 25);
+  c.addi(10, 10, 1);
+  c.branch(CodeBuilder::BNE, 10, 13, row);
+  c.addi(27, 27, -1);
+  c.branch(CodeBuilder::BNE, 27, 0, repeat);
+  // checksum of C
+  c.li(1, C);
+  c.li(2, n * n);
+  const Word sum = c.here();
+  c.lw(3, 1, 0);
+  c.add(26, 26, 3);
+  c.addi(1, 1, 4);
+  c.addi(2, 2, -1);
+  c.branch(CodeBuilder::BNE, 2, 0, sum);
+  k.code = c.getCode();
+  return k;
+}
+
+// counts the bits of an xorshift sequence with data-dependent branches
+Kernel branchy() {
+  constexpr Word iterations = 1 << 17, seed = 0x12345678;
+  Kernel k{"branchy", {}, {}, 3, 0};
+  Word x = seed;
+  for (Word i = 0; i < iterations; ++i) {
+    x ^= x << 13;
+    x ^= static_cast<Word>(static_cast<SignedWord>(x) >> 17);
+    x ^= x << 5;
+    k.expected += (x & 1) + ((x & 2) == 0);
+  }
+
+  CodeBuilder c;
+  c.li(1, seed);
+  c.li(2, iterations);
+  c.li(5, 5);
+  c.li(6, 17);
+  c.li(7, 13);
+  c.li(8, 2);
+  c.li(9, 1);
+  const Word loop = c.here();
+  c.sll(10, 1, 7);
+  c.xor_(1, 1, 10);
+  c.sra(10, 1, 6);
+  c.xor_(1, 1, 10);
+  c.sll(10, 1, 5);
+  c.xor_(1, 1, 10);
+  c.and_(11, 1, 9);
+  const std::size_t odd = c.branchForward(CodeBuilder::BEQ, 11, 0);
+  c.addi(3, 3, 1);
+  c.patch(odd, c.here());
+  c.and_(11, 1, 8);
+  const std::size_t clear = c.branchForward(CodeBuilder::BNE, 11, 0);
+  c.addi(4, 4, 1);
+  c.patch(clear, c.here());
+  c.addi(2, 2, -1);
+  c.branch(CodeBuilder::BNE, 2, 0, loop);
+  c.add(3, 3, 4);
+  k.code = c.getCode();
+  return k;
+}
+
+// simulates the kernel with the default cache, returning the instructions run
+std::uint64_t runKernel(const Kernel &kernel, const Engine engine,
+                        const Timing timing = Timing::Serial) {
+  MainMemory mainMemory{100, kernel_memory};
+  CacheHierarchy caches{HierarchyConfig{}, &mainMemory};
+  Memory memory{&mainMemory, caches};
+  for (Word i = 0; i < kernel.code.size(); ++i)
+    memory.writeDataToMainMemory(4 * i, kernel.code[i]);
+  for (const auto &[address, value] : kernel.data)
+    memory.writeDataToMainMemory(address, value);
+
+  SimulationConfig config;
+  config.engine = engine;
+  config.timing = timing;
+  config.trace_level = TraceLevel::None;
+  Simulation sim{memory, "", config};
+  sim.start(Program{0, 0, static_cast<Word>(4 * kernel.code.size())});
+  sim.resume();
+  if (sim.registers().getReg(kernel.result_register) != kernel.expected)
+    throw std::runtime_error("kernel " + kernel.name + " computed a wrong result");
+  return sim.getInstructions();
+}
+
+// Runs f, which returns the work it did, until at least min_time seconds have
+// passed after a warm-up run, and returns the work done per second.
+template <typename F> double measure(const double min_time, F f) {
+  using clock = std::chrono::steady_clock;
+  f();
+  double work = 0, seconds = 0;
+  const auto start = clock::now();
+  do {
+    work += f();
+    seconds = std::chrono::duration<double>(clock::now() - start).count();
+  } while (seconds < min_time);
+  return work / seconds;
+}
+
+struct Result {
+  std::string name, unit;
+  // higher is better for every unit
+  double value;
+};
+
+// keeps loaded values alive so that the loops are not optimized away
+volatile Word sink;
+
+void runBenchmarks(const std::string &filter, const double min_time,
+                   std::vector<Result> &results) {
+  auto wanted = [&](const std::string &name) {
+    return name.find(filter) != std::string::npos;
+  };
+
+  const Kernel kernels[] = {pointerChase(), streaming(), matmul(), branchy()};
+  for (const Kernel &kernel : kernels) {
+    for (const auto &[engine, engine_name] :
+         {std::pair{Engine::Interpreter, "interpreter"}, {Engine::BasicBlock, "block"}}) {
+      const std::string name = "sim/" + kernel.name + "/" + engine_name;
+      if (wanted(name))
+        results.push_back({name, "MIPS", measure(min_time, [&] {
+                             return runKernel(kernel, engine);
+                           }) / 1e6});
+    }
+    // the cost of the timing models on top of the interpreter
+    for (const auto &[timing, timing_name] :
+         {std::pair{Timing::Pipeline, "pipeline"}, {Timing::Event, "event"}}) {
+      const std::string name = "sim/" + kernel.name + "/" + timing_name;
+      if (wanted(name))
+        results.push_back({name, "MIPS", measure(min_time, [&] {
+                             return runKernel(kernel, Engine::Interpreter, timing);
+                           }) / 1e6});
+    }
+  }
+
+  // every instruction word of the kernels, as decoded on first fetch
+  if (wanted("decode")) {
+    std::vector<Instruction> words;
+    for (const Kernel &kernel : kernels)
+      words.insert(words.end(), kernel.code.begin(), kernel.code.end());
+    results.push_back({"decode", "Minsts/s", measure(min_time, [&] {
+                         for (const Instruction word : words)
+                           sink = static_cast<Word>(decode(word).op);
+                         return words.size();
+                       }) / 1e6});
+  }
+
+  // random word addresses over twice the cache, so both hits and misses
+  constexpr Word cache_size = 1024;
+  std::vector<Word> addresses(1 << 16);
+  std::mt19937 rng(2);
+  for (Word &address : addresses)
+    address = 4 * std::uniform_int_distribution<Word>(0, 2 * cache_size - 1)(rng);
+
+  for (const WritePolicy WP : {WritePolicy::WriteThrough, WritePolicy::WriteBack}) {
+    for (const ReplacementPolicy RP :
+         {ReplacementPolicy::LRU, ReplacementPolicy::FIFO, ReplacementPolicy::RANDOM}) {
+      for (const Word associativity : {1u, 4u, 16u}) {
+        const std::string prefix =
+            std::string("cache/") + (WP == WritePolicy::WriteBack ? "wb" : "wt") + "-" +
+            (RP == ReplacementPolicy::LRU    ? "lru"
+             : RP == ReplacementPolicy::FIFO ? "fifo"
+                                             : "random") +
+            "-" + std::to_string(associativity) + "way";
+        CacheConfig config;
+        config.size = cache_size;
+        config.block_size = 4;
+        config.associativity = associativity;
+        config.WP = WP;
+        config.RP = RP;
+        MainMemory mainMemory{100, 2 * cache_size};
+        std::unique_ptr<Cache> cache = makeCache(config);
+        cache->setMemory(&mainMemory);
+
+        if (wanted(prefix + "/read"))
+          results.push_back({prefix + "/read", "Maccesses/s", measure(min_time, [&] {
+                               for (const Word address : addresses)
+                                 sink = cache->getData(address).first;
+                               return addresses.size();
+                             }) / 1e6});
+        if (wanted(prefix + "/write"))
+          results.push_back({prefix + "/write", "Maccesses/s", measure(min_time, [&] {
+                               for (const Word address : addresses)
+                                 cache->writeData(address, address);
+                               return addresses.size();
+                             }) / 1e6});
+      }
+    }
+  }
+
+  // 4 MiB written once so that every page is allocated
+  constexpr Word memory_words = 1 << 20;
+  MainMemory mainMemory{100, memory_words};
+  for (Word i = 0; i < memory_words; ++i)
+    mainMemory.writeData(4 * i, i);
+  for (const Word block_size : {4u, 64u, 1024u}) {
+    std::vector<Word> block(block_size);
+    const std::string read = "memory/read-" + std::to_string(block_size);
+    const std::string write = "memory/write-" + std::to_string(block_size);
+    if (wanted(read))
+      results.push_back({read, "MB/s", measure(min_time, [&] {
+                           for (Word i = 0; i < memory_words; i += block_size)
+                             mainMemory.readBlock(4 * i, Span<Word>(block.data(), block_size));
+                           sink = block[0];
+                           return 4.0 * memory_words;
+                         }) / 1e6});
+    if (wanted(write))
+      results.push_back({write, "MB/s", measure(min_time, [&] {
+                           for (Word i = 0; i < memory_words; i += block_size)
+                             mainMemory.writeBlock(4 * i,
+                                                   Span<const Word>(block.data(), block_size));
+                           return 4.0 * memory_words;
+                         }) / 1e6});
+  }
+}
+
+void writeResults(std::ostream &os, const std::vector<Result> &results) {
+  os << "benchmark,unit,value\n";
+  os << std::fixed << std::setprecision(3);
+  for (const Result &r : results)
+    os << r.name << "," << r.unit << "," << r.value << "\n";
+}
+
+std::map<std::string, double> readResults(const std::string &path) {
+  std::ifstream file(path);
+  if (not file)
+    throw std::runtime_error("cannot read baseline '" + path + "'");
+  std::map<std::string, double> values;
+  std::string line;
+  std::getline(file, line); // header
+  while (std::getline(file, line)) {
+    const std::size_t first = line.find(','), last = line.rfind(',');
+    if (first == std::string::npos or first == last)
+      throw std::runtime_error("malformed baseline line '" + line + "'");
+    values[line.substr(0, first)] = std::stod(line.substr(last + 1));
+  }
+  return values;
+}
+
+// prints every benchmark against the baseline, returning whether none of
+// them regressed by more than tolerance percent
+bool compare(std::ostream &os, const std::vector<Result> &results,
+             const std::map<std::string, double> &baseline, const double tolerance) {
+  bool ok = true;
+  os << std::left << std::fixed << std::setprecision(3);
+  os << std::setw(32) << "benchmark" << std::setw(14) << "baseline" << std::setw(14)
+     << "current" << "change\n";
+  for (const Result &r : results) {
+    auto it = baseline.find(r.name);
+    if (it == baseline.end()) {
+      os << std::setw(32) << r.name << std::setw(14) << "-" << std::setw(14) << r.value
+         << "new\n";
+      continue;
+    }
+    const double change = 100 * (r.value / it->second - 1);
+    const bool regressed = change < -tolerance;
+    ok = ok and not regressed;
+    std::ostringstream percent;
+    percent << std::fixed << std::setprecision(1) << std::showpos << change << "%";
+    os << std::setw(32) << r.name << std::setw(14) << it->second << std::setw(14) << r.value
+       << percent.str() << (regressed ? " REGRESSION" : "") << "\n";
+  }
+  os << std::right;
+  return ok;
+}
+
+void usage() {
+  std::cerr << "Usage: risc-v-sim-bench [options]\n"
+               "Options:\n"
+               "  --filter=<text>       only run benchmarks whose name contains text\n"
+               "  --min-time=<seconds>  time spent measuring each benchmark (default: 0.2)\n"
+               "  --output=<path>       write the results as CSV to path instead of standard\n"
+               "                        output\n"
+               "  --baseline=<path>     compare against earlier results and fail on regressions\n"
+               "  --tolerance=<percent> slowdown tolerated by --baseline (default: 10)\n";
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  std::string filter, output_path, baseline_path;
+  double min_time = 0.2, tolerance = 10;
+  try {
+    for (const std::string &arg : std::vector<std::string>(argv + 1, argv + argc)) {
+      if (arg.rfind("--filter=", 0) == 0) {
+        filter = arg.substr(std::string("--filter=").size());
+      } else if (arg.rfind("--min-time=", 0) == 0) {
+        min_time = std::stod(arg.substr(std::string("--min-time=").size()));
+      } else if (arg.rfind("--output=", 0) == 0) {
+        output_path = arg.substr(std::string("--output=").size());
+      } else if (arg.rfind("--baseline=", 0) == 0) {
+        baseline_path = arg.substr(std::string("--baseline=").size());
+      } else if (arg.rfind("--tolerance=", 0) == 0) {
+        tolerance = std::stod(arg.substr(std::string("--tolerance=").size()));
+      } else {
+        usage();
+        return 1;
+      }
+    }
+  } catch (std::exception &) {
+    usage();
+    return 1;
+  }
+
+  try {
+    std::vector<Result> results;
+    runBenchmarks(filter, min_time, results);
+
+    if (not output_path.empty()) {
+      std::ofstream output(output_path);
+      if (not output)
+        throw std::runtime_error("cannot write results '" + output_path + "'");
+      writeResults(output, results);
+    } else if (baseline_path.empty()) {
+      writeResults(std::cout, results);
+    }
+    if (not baseline_path.empty() and
+        not compare(std::cout, results, readResults(baseline_path), tolerance))
+      return 1;
+  } catch (std::exception &e) {
+    std::cerr << "error: " << e.what() << "\n";
+    return 1;
+  }
+  return 0;
+}
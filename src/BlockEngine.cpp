@@ -0,0 +1,191 @@
+/* Basic-block execution engine.
+ *
+ * Instructions are translated once per basic block (a straight-line run ending
+ * at a B-type, JAL or JALR instruction) and blocks are chained to the blocks
+ * that follow them. Every instruction is still fetched through the memory
+ * subsystem, so cycle accounting is identical to the interpreter's. Under
+ * serial timing with nothing traced or profiled, blocks run through a loop
+ * that calls the handlers directly and sums the cycles of the whole block.
+ */
+#include "Simulation.hpp"
+#include <algorithm> // for std::find
+
+namespace {
+
+bool endsBlock(const Operation op) {
+  switch (op) {
+  case Operation::BEQ:
+  case Operation::BNE:
+  case Operation::BLT:
+  case Operation::BGE:
+  case Operation::BLTU:
+  case Operation::BGEU:
+  case Operation::JAL:
+  case Operation::JALR:
+  // so do instructions that throw once executed
+  case Operation::ECALL:
+  case Operation::EBREAK:
+  case Operation::INVALID_OPCODE:
+  case Operation::INVALID_INSTRUCTION:
+    return true;
+  default:
+    return false;
+  }
+}
+
+} // namespace
+
+Cycle Simulation::runBlocks(Word PC, const Word end) {
+  Cycle time = 0;
+
+  Block *block = nullptr;
+  while (PC != end) {
+    // blocks are only translated inside program memory, anything else is
+    // left to the interpreter one instruction at a time
+    if (PC < program_begin or PC >= program_end) {
+      tracePC(PC);
+      auto [inst, t_fetch] = memory.fetchInstruction(PC);
+      const DecodedInstruction &d = getDecoded(PC, inst);
+      auto [new_PC, t_execute] = execute(d, PC);
+      const Cycle t = charge(d, PC, new_PC, t_fetch, t_execute);
+      traceRetire(PC, d, t);
+      PC = new_PC;
+      time += t;
+      block = nullptr;
+      continue;
+    }
+
+    if (block == nullptr)
+      block = getBlock(PC);
+
+    Word next_PC = executeBlock(*block, time);
+
+    // follow (and if needed create) the chain to the next block; the link
+    // slots are checked against the target since JALR targets can vary
+    Block *&link = next_PC == block->start + 4 * block->insts.size() ? block->fallthrough
+                                                                    : block->taken;
+    if (next_PC == end or next_PC < program_begin or next_PC >= program_end) {
+      block = nullptr;
+    } else {
+      if (link == nullptr or link->start != next_PC or link->stale)
+        link = getBlock(next_PC);
+      block = link;
+    }
+    PC = next_PC;
+  }
+
+  return time;
+}
+
+Simulation::Block *Simulation::getBlock(const Word PC) {
+  auto &slot = blocks[PC];
+  if (not slot) {
+    slot = std::make_unique<Block>();
+    slot->start = PC;
+    translate(*slot);
+  } else if (slot->stale) {
+    translate(*slot);
+  }
+  return slot.get();
+}
+
+void Simulation::translate(Block &block) {
+  block.insts.clear();
+  block.stale = false;
+  // successors of the old translation may no longer be reachable
+  block.fallthrough = block.taken = nullptr;
+
+  // translated from what fetches would return, a dirty cached copy of the
+  // code included
+  for (Word PC = block.start; PC < program_end; PC += 4) {
+    block.insts.push_back(decode(memory.peekInstruction(PC)));
+    if (endsBlock(block.insts.back().op))
+      break;
+  }
+
+  const Word first = (block.start - program_begin) / CodeWriteTracker::page_bytes;
+  const Word last =
+      (block.start + 4 * (block.insts.size() - 1) - program_begin) / CodeWriteTracker::page_bytes;
+  for (Word page = first; page <= last; ++page) {
+    std::vector<Block *> &list = page_blocks[page];
+    // a block gone stale by a mismatched fetch is still listed
+    if (std::find(list.begin(), list.end(), &block) == list.end())
+      list.push_back(&block);
+  }
+}
+
+void Simulation::invalidateBlocks(const Word begin, const Word end) {
+  const Word first = (begin - program_begin) / CodeWriteTracker::page_bytes;
+  const Word last = (end - 1 - program_begin) / CodeWriteTracker::page_bytes;
+  for (Word page = first; page <= last; ++page) {
+    for (Block *block : page_blocks[page])
+      block->stale = true;
+    page_blocks[page].clear();
+  }
+}
+
+Word Simulation::executeBlock(Block &block, Cycle &time) {
+  // the common case skips the timing model, tracer and profiler hooks
+  if (not pipeline and not event_core and not profiler and not tracer.enabled(TraceLevel::PC))
+    return executePlainBlock(block, time);
+  Word PC = block.start;
+  for (const DecodedInstruction &d : block.insts) {
+    tracePC(PC);
+
+    auto [inst, t_fetch] = memory.fetchInstruction(PC);
+
+    // stores into program memory mark the blocks of their page stale, but a
+    // block may still be executing when one of its own later words is
+    // written, and an instruction cache may hold an older copy than the one
+    // translated; the fetched word is what actually executes, so on mismatch
+    // fall back to the interpreter's record and leave the block, which is
+    // retranslated on its next use
+    const bool matches = inst == d.raw;
+    const DecodedInstruction &executed = matches ? d : getDecoded(PC, inst);
+    auto [new_PC, t_execute] = execute(executed, PC);
+    const Cycle t = charge(executed, PC, new_PC, t_fetch, t_execute);
+
+    traceRetire(PC, executed, t);
+
+    PC = new_PC;
+    time += t;
+
+    if (not matches) {
+      block.stale = true;
+      break;
+    }
+  }
+  return PC;
+}
+
+// executeBlock under serial timing with nothing traced or profiled, where an
+// instruction costs its fetch and execute cycles and nothing else is recorded
+Word Simulation::executePlainBlock(Block &block, Cycle &time) {
+  Word PC = block.start;
+  Cycle t = 0;
+  for (const DecodedInstruction &d : block.insts) {
+    auto [inst, t_fetch] = memory.fetchInstruction(PC);
+    if (inst != d.raw) {
+      // the block is out of date, see executeBlock
+      const DecodedInstruction &executed = getDecoded(PC, inst);
+      auto [new_PC, t_execute] = execute(executed, PC);
+      ++instructions;
+      time += t + t_fetch + t_execute;
+      block.stale = true;
+      return new_PC;
+    }
+    // execute() inlined: handlers add their memory cycles to the 2 of
+    // decode and execute, writeback takes 1 more
+    Word result = 0;
+    Cycle t_execute = 2;
+    PC = (this->*handlers[static_cast<std::size_t>(d.op)])(d, PC, result, t_execute);
+    if (d.rd != no_of_registers) {
+      RF.writeReg(d.rd, result);
+      ++t_execute;
+    }
+    ++instructions;
+    t += t_fetch + t_execute;
+  }
+  time += t;
+  return PC;
+}
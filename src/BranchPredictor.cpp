@@ -0,0 +1,313 @@
+#include "BranchPredictor.hpp"
+#include "Serialize.hpp"
+#include "Sweep.hpp" // for parseGridAxes
+#include <algorithm> // for std::min
+
+PredictorConfig parsePredictorConfig(const std::string &spec) {
+  PredictorConfig config;
+  const std::size_t comma = spec.find(',');
+  const std::string kind = spec.substr(0, comma);
+  if (kind == "nottaken")
+    config.kind = PredictorKind::NotTaken;
+  else if (kind == "taken")
+    config.kind = PredictorKind::Taken;
+  else if (kind == "btfn")
+    config.kind = PredictorKind::BTFN;
+  else if (kind == "bimodal")
+    config.kind = PredictorKind::Bimodal;
+  else if (kind == "gshare")
+    config.kind = PredictorKind::GShare;
+  else if (kind == "tournament")
+    config.kind = PredictorKind::Tournament;
+  else
+    throw std::runtime_error("unknown branch predictor '" + kind + "'");
+
+  if (comma != std::string::npos) {
+    for (const auto &[key, values] : parseGridAxes(spec.substr(comma + 1))) {
+      if (values.size() != 1)
+        throw std::runtime_error("predictor setting '" + key + "' takes a single value");
+      const Word value = std::stoul(values[0], nullptr, 0);
+      if (key == "entries")
+        config.entries = value;
+      else if (key == "history")
+        config.history = value;
+      else if (key == "btb")
+        config.btb = value;
+      else if (key == "ras")
+        config.ras = value;
+      else
+        throw std::runtime_error("unknown predictor setting '" + key + "'");
+    }
+  }
+
+  if (config.entries == 0 or config.entries & (config.entries - 1) or
+      config.btb & (config.btb - 1))
+    throw std::runtime_error("predictor and BTB entries must be powers of 2");
+  if (config.history > 30)
+    throw std::runtime_error("global history is limited to 30 bits");
+  return config;
+}
+
+namespace {
+
+// saturating 2-bit counters, taken from 2 up
+void train(std::uint8_t &counter, const bool taken) {
+  if (taken and counter < 3)
+    ++counter;
+  else if (not taken and counter > 0)
+    --counter;
+}
+
+class StaticPredictor final : public DirectionPredictor {
+  const PredictorKind kind;
+
+public:
+  StaticPredictor(const PredictorKind kind_) : kind(kind_) {}
+
+  bool predict(const DecodedInstruction &d, const Word) override {
+    switch (kind) {
+    case PredictorKind::Taken:
+      return true;
+    case PredictorKind::BTFN:
+      // backward branches close loops
+      return static_cast<SignedWord>(d.imm) < 0;
+    default:
+      return false;
+    }
+  }
+
+  void update(const Word, const bool) override {}
+};
+
+// a counter per branch, indexed by the PC
+class BimodalPredictor final : public DirectionPredictor {
+  std::vector<std::uint8_t> counters;
+  const Word mask;
+
+public:
+  BimodalPredictor(const Word entries) : counters(entries, 1), mask(entries - 1) {}
+
+  bool predict(const DecodedInstruction &, const Word PC) override {
+    return counters[(PC >> 2) & mask] >= 2;
+  }
+
+  void update(const Word PC, const bool taken) override {
+    train(counters[(PC >> 2) & mask], taken);
+  }
+
+  void save(std::ostream &os) const override { writeArray(os, counters); }
+  void restore(std::istream &is) override { readArray(is, counters); }
+};
+
+// counters indexed by the PC xor the outcomes of the latest branches
+class GSharePredictor final : public DirectionPredictor {
+  std::vector<std::uint8_t> counters;
+  const Word mask, history_mask;
+  Word history = 0;
+
+  Word index(const Word PC) const { return ((PC >> 2) ^ history) & mask; }
+
+public:
+  GSharePredictor(const Word entries, const Word history_bits)
+      : counters(entries, 1), mask(entries - 1), history_mask((1u << history_bits) - 1) {}
+
+  bool predict(const DecodedInstruction &, const Word PC) override {
+    return counters[index(PC)] >= 2;
+  }
+
+  void update(const Word PC, const bool taken) override {
+    train(counters[index(PC)], taken);
+    history = (history << 1 | taken) & history_mask;
+  }
+
+  void save(std::ostream &os) const override {
+    writeArray(os, counters);
+    writeValue(os, history);
+  }
+
+  void restore(std::istream &is) override {
+    readArray(is, counters);
+    history = readValue<Word>(is);
+  }
+};
+
+// a per-PC chooser between a bimodal and a gshare predictor, trained
+// towards whichever was right when they disagree
+class TournamentPredictor final : public DirectionPredictor {
+  BimodalPredictor local;
+  GSharePredictor global;
+  std::vector<std::uint8_t> choosers;
+  const Word mask;
+  bool local_prediction = false, global_prediction = false;
+
+public:
+  TournamentPredictor(const Word entries, const Word history_bits)
+      : local(entries), global(entries, history_bits), choosers(entries, 1),
+        mask(entries - 1) {}
+
+  bool predict(const DecodedInstruction &d, const Word PC) override {
+    local_prediction = local.predict(d, PC);
+    global_prediction = global.predict(d, PC);
+    return choosers[(PC >> 2) & mask] >= 2 ? global_prediction : local_prediction;
+  }
+
+  void update(const Word PC, const bool taken) override {
+    if (local_prediction != global_prediction)
+      train(choosers[(PC >> 2) & mask], global_prediction == taken);
+    local.update(PC, taken);
+    global.update(PC, taken);
+  }
+
+  void save(std::ostream &os) const override {
+    local.save(os);
+    global.save(os);
+    writeArray(os, choosers);
+  }
+
+  void restore(std::istream &is) override {
+    local.restore(is);
+    global.restore(is);
+    readArray(is, choosers);
+  }
+};
+
+} // namespace
+
+std::unique_ptr<DirectionPredictor> makeDirectionPredictor(const PredictorConfig &config) {
+  switch (config.kind) {
+  case PredictorKind::Bimodal:
+    return std::make_unique<BimodalPredictor>(config.entries);
+  case PredictorKind::GShare:
+    return std::make_unique<GSharePredictor>(config.entries, config.history);
+  case PredictorKind::Tournament:
+    return std::make_unique<TournamentPredictor>(config.entries, config.history);
+  default:
+    return std::make_unique<StaticPredictor>(config.kind);
+  }
+}
+
+BranchPredictor::BranchPredictor(const PredictorConfig &config_)
+    : config(config_), direction(makeDirectionPredictor(config)), btb(config.btb),
+      ras(config.ras) {}
+
+std::pair<bool, Word> BranchPredictor::predictTarget(const DecodedInstruction &d,
+                                                     const Word PC) {
+  if (isReturn(d) and ras_size > 0) {
+    ras_top = (ras_top + ras.size() - 1) % ras.size();
+    --ras_size;
+    return {true, ras[ras_top]};
+  }
+  if (btb.empty())
+    return {false, 0};
+  const BTBEntry &entry = btb[(PC >> 2) & (btb.size() - 1)];
+  const bool hit = entry.valid and entry.PC == PC;
+  ++(hit ? btb_hits : btb_misses);
+  return {hit, entry.target};
+}
+
+bool BranchPredictor::resolve(const DecodedInstruction &d, const Word PC, const Word next_PC) {
+  const bool jump = isJump(d.op);
+  const bool conditional = isBranch(d.op);
+  if (not jump and not conditional)
+    return true;
+
+  const bool taken = jump or next_PC != PC + 4;
+  bool correct = not taken;
+  if (jump or direction->predict(d, PC)) {
+    const bool from_ras = isReturn(d) and ras_size > 0;
+    const auto [known, target] = predictTarget(d, PC);
+    correct = taken and known and target == next_PC;
+    if (from_ras)
+      ++(correct ? ras_hits : ras_misses);
+  }
+
+  if (conditional)
+    direction->update(PC, taken);
+  if (taken and not btb.empty())
+    btb[(PC >> 2) & (btb.size() - 1)] = {true, PC, next_PC};
+  if (isCall(d) and not ras.empty()) {
+    ras[ras_top] = PC + 4;
+    ras_top = (ras_top + 1) % ras.size();
+    ras_size = std::min(ras_size + 1, ras.size());
+  }
+
+  BranchStats &stats = branches[PC];
+  ++stats.executed;
+  ++total.executed;
+  if (not correct) {
+    ++stats.mispredicted;
+    ++total.mispredicted;
+  }
+  return correct;
+}
+
+void BranchPredictor::save(std::ostream &os) const {
+  writeValue(os, config.kind);
+  writeValue(os, config.entries);
+  writeValue(os, config.history);
+  writeValue(os, config.btb);
+  writeValue(os, config.ras);
+  direction->save(os);
+  writeArray(os, btb);
+  writeArray(os, ras);
+  writeValue(os, ras_top);
+  writeValue(os, ras_size);
+  writeValue(os, total);
+  writeValue(os, btb_hits);
+  writeValue(os, btb_misses);
+  writeValue(os, ras_hits);
+  writeValue(os, ras_misses);
+  writeValue<std::uint64_t>(os, branches.size());
+  for (const auto &[PC, stats] : branches) {
+    writeValue(os, PC);
+    writeValue(os, stats);
+  }
+}
+
+bool BranchPredictor::restore(std::istream &is) {
+  if (readValue<PredictorKind>(is) != config.kind or readValue<Word>(is) != config.entries or
+      readValue<Word>(is) != config.history or readValue<Word>(is) != config.btb or
+      readValue<Word>(is) != config.ras)
+    return false;
+  direction->restore(is);
+  readArray(is, btb);
+  readArray(is, ras);
+  ras_top = readValue<std::size_t>(is);
+  ras_size = readValue<std::size_t>(is);
+  total = readValue<BranchStats>(is);
+  btb_hits = readValue<std::uint64_t>(is);
+  btb_misses = readValue<std::uint64_t>(is);
+  ras_hits = readValue<std::uint64_t>(is);
+  ras_misses = readValue<std::uint64_t>(is);
+  branches.clear();
+  for (auto n = readValue<std::uint64_t>(is); n > 0; --n) {
+    const Word PC = readValue<Word>(is);
+    branches[PC] = readValue<BranchStats>(is);
+  }
+  return true;
+}
+
+void BranchPredictor::dump(std::ostream &os) const {
+  auto accuracy = [](const BranchStats &stats) {
+    return 100 * static_cast<long double>(stats.executed - stats.mispredicted) / stats.executed;
+  };
+
+  os << "Branch Predictor\n";
+  os << "================\n";
+  os << "Branches: " << total.executed << "\tMispredictions: " << total.mispredicted
+     << "\tAccuracy: " << accuracy(total) << "%\n";
+  os << "BTB Hits: " << btb_hits << "\tBTB Misses: " << btb_misses << "\tRAS Hits: " << ras_hits
+     << "\tRAS Misses: " << ras_misses << "\n";
+
+  // formatting changes
+  char prev_fill = os.fill('0');
+
+  for (const auto &[PC, stats] : branches) {
+    os << "0x" << std::hex << std::setw(XLEN / 4) << PC << std::dec << " : " << stats.executed
+       << " executed\t" << stats.mispredicted << " mispredicted\t" << accuracy(stats)
+       << "% accuracy\n";
+  }
+
+  // reset formatting changes
+  os.fill(prev_fill);
+}
@@ -0,0 +1,94 @@
+#ifndef __BRANCH_PREDICTOR_H
+#define __BRANCH_PREDICTOR_H
+
+#include "Decoder.hpp"
+#include <cstdint> // for std::uint8_t, std::uint64_t
+#include <map>     // for std::map
+#include <memory>  // for std::unique_ptr
+#include <string>
+#include <vector>  // for std::vector
+
+enum class PredictorKind { NotTaken, Taken, BTFN, Bimodal, GShare, Tournament };
+
+struct PredictorConfig {
+  PredictorKind kind = PredictorKind::Bimodal;
+  // 2-bit counters of each table, a power of 2
+  Word entries = 1024;
+  // bits of global history of gshare and tournament
+  Word history = 10;
+  // branch target buffer entries (a power of 2) and return address stack
+  // depth; 0 leaves them out
+  Word btb = 64, ras = 8;
+};
+
+// Parses "<kind>,entries=<n>,history=<bits>,btb=<entries>,ras=<depth>" where
+// kind is nottaken, taken, btfn, bimodal, gshare or tournament.
+PredictorConfig parsePredictorConfig(const std::string &spec);
+
+// Predicts whether conditional branches are taken. Implementations are
+// picked at runtime by makeDirectionPredictor.
+class DirectionPredictor {
+public:
+  virtual ~DirectionPredictor() = default;
+
+  virtual bool predict(const DecodedInstruction &d, const Word PC) = 0;
+
+  // trains on the outcome of the branch predict was last asked about
+  virtual void update(const Word PC, const bool taken) = 0;
+
+  // checkpointing of the tables, static predictors have none
+  virtual void save(std::ostream &) const {}
+  virtual void restore(std::istream &) {}
+};
+
+std::unique_ptr<DirectionPredictor> makeDirectionPredictor(const PredictorConfig &config);
+
+struct BranchStats {
+  std::uint64_t executed = 0, mispredicted = 0;
+};
+
+// Front end prediction of every branch and jump: the direction of
+// conditional branches, and the target of taken ones from the BTB or, for
+// returns, the return address stack. A prediction is only correct if both
+// are; fetch then goes on without a bubble.
+class BranchPredictor final {
+  const PredictorConfig config;
+  std::unique_ptr<DirectionPredictor> direction;
+
+  // direct-mapped, tagged with the whole PC
+  struct BTBEntry {
+    bool valid = false;
+    Word PC = 0, target = 0;
+  };
+  std::vector<BTBEntry> btb;
+  // circular, overflowing calls overwrite the oldest entries
+  std::vector<Word> ras;
+  std::size_t ras_top = 0, ras_size = 0;
+
+  BranchStats total;
+  std::uint64_t btb_hits = 0, btb_misses = 0, ras_hits = 0, ras_misses = 0;
+  // every branch and jump executed, by PC
+  std::map<Word, BranchStats> branches;
+
+  // the target fetch would go on at if the transfer is taken, if it knows one
+  std::pair<bool, Word> predictTarget(const DecodedInstruction &d, const Word PC);
+
+public:
+  explicit BranchPredictor(const PredictorConfig &config_);
+
+  // Accounts for a branch or jump at PC that continued at next_PC, returning
+  // whether fetch predicted it; other instructions are always predicted.
+  bool resolve(const DecodedInstruction &d, const Word PC, const Word next_PC);
+
+  const BranchStats &getStats() const { return total; }
+
+  // Checkpointing of the tables, BTB, return address stack and statistics.
+  // restore only takes state saved by a predictor of the same configuration
+  // and returns false, changing nothing, for any other.
+  void save(std::ostream &os) const;
+  bool restore(std::istream &is);
+
+  void dump(std::ostream &os) const;
+};
+
+#endif /* end of __BRANCH_PREDICTOR_H */
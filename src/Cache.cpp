@@ -0,0 +1,171 @@
+#include "Cache.hpp"
+
+namespace {
+
+template <WritePolicy WP, ReplacementPolicy RP>
+std::unique_ptr<Cache> makeCacheWithPolicies(const CacheConfig &config) {
+  switch (config.associativity) {
+  case 1:
+    return std::make_unique<CacheImpl<WP, RP, 1>>(config);
+  case 2:
+    return std::make_unique<CacheImpl<WP, RP, 2>>(config);
+  case 4:
+    return std::make_unique<CacheImpl<WP, RP, 4>>(config);
+  case 8:
+    return std::make_unique<CacheImpl<WP, RP, 8>>(config);
+  case 16:
+    return std::make_unique<CacheImpl<WP, RP, 16>>(config);
+  default:
+    // e.g. fully associative caches, associativity is only known at runtime
+    return std::make_unique<CacheImpl<WP, RP, 0>>(config);
+  }
+}
+
+template <WritePolicy WP>
+std::unique_ptr<Cache> makeCacheWithWritePolicy(const CacheConfig &config) {
+  switch (config.RP) {
+  case ReplacementPolicy::LRU:
+    return makeCacheWithPolicies<WP, ReplacementPolicy::LRU>(config);
+  case ReplacementPolicy::RANDOM:
+    return makeCacheWithPolicies<WP, ReplacementPolicy::RANDOM>(config);
+  case ReplacementPolicy::FIFO:
+    return makeCacheWithPolicies<WP, ReplacementPolicy::FIFO>(config);
+  default:
+    throw std::runtime_error("unknown replacement policy");
+  }
+}
+
+} // namespace
+
+std::unique_ptr<Cache> makeCache(const CacheConfig &config) {
+  checkCacheConfig(config);
+  switch (config.WP) {
+  case WritePolicy::WriteBack:
+    return makeCacheWithWritePolicy<WritePolicy::WriteBack>(config);
+  case WritePolicy::WriteThrough:
+    return makeCacheWithWritePolicy<WritePolicy::WriteThrough>(config);
+  default:
+    throw std::runtime_error("unknown write policy");
+  }
+}
+
+void checkCacheConfig(const CacheConfig &config) {
+  auto powerOf2 = [](const Word x) { return x != 0 and (x & (x - 1)) == 0; };
+  if (not powerOf2(config.size) or not powerOf2(config.block_size) or
+      not powerOf2(config.associativity) or
+      config.size < std::uint64_t(config.block_size) * config.associativity)
+    throw std::runtime_error("cache size, block size and associativity must be powers of 2, "
+                             "with the size at least block size times associativity");
+  const PrefetcherConfig &prefetch = config.prefetch;
+  if (prefetch.degree == 0 or prefetch.distance == 0 or prefetch.table == 0 or
+      prefetch.table & (prefetch.table - 1))
+    throw std::runtime_error("prefetch degree and distance must be positive and the table a "
+                             "power of 2");
+  if (config.mshrs > max_buffer_entries or config.write_buffer > max_buffer_entries or
+      config.victim_lines > max_buffer_entries)
+    throw std::runtime_error("a cache has at most " + std::to_string(max_buffer_entries) +
+                             " MSHRs, write buffer entries and victim lines");
+}
+
+CacheConfig parseCacheSettings(const std::string &spec, CacheConfig base) {
+  std::size_t begin = 0;
+  while (begin < spec.size()) {
+    std::size_t end = spec.find(',', begin);
+    if (end == std::string::npos)
+      end = spec.size();
+    const std::string setting = spec.substr(begin, end - begin);
+    begin = end + 1;
+
+    const std::size_t eq = setting.find('=');
+    if (eq == std::string::npos)
+      throw std::runtime_error("cache setting '" + setting + "' is not key=value");
+    const std::string key = setting.substr(0, eq), value = setting.substr(eq + 1);
+
+    if (key == "size")
+      base.size = std::stoul(value, nullptr, 0);
+    else if (key == "block")
+      base.block_size = std::stoul(value, nullptr, 0);
+    else if (key == "assoc")
+      base.associativity = std::stoul(value, nullptr, 0);
+    else if (key == "hit")
+      base.hit_time = std::stoul(value, nullptr, 0);
+    else if (key == "miss")
+      base.miss_penalty = std::stoul(value, nullptr, 0);
+    else if (key == "write" and value == "wb")
+      base.WP = WritePolicy::WriteBack;
+    else if (key == "write" and value == "wt")
+      base.WP = WritePolicy::WriteThrough;
+    else if (key == "repl" and value == "lru")
+      base.RP = ReplacementPolicy::LRU;
+    else if (key == "repl" and value == "fifo")
+      base.RP = ReplacementPolicy::FIFO;
+    else if (key == "repl" and value == "random")
+      base.RP = ReplacementPolicy::RANDOM;
+    else if (key == "seed")
+      base.seed = std::stoull(value, nullptr, 0);
+    else if (key == "prefetch" and value == "none")
+      base.prefetch.kind = PrefetcherKind::None;
+    else if (key == "prefetch" and value == "next")
+      base.prefetch.kind = PrefetcherKind::NextLine;
+    else if (key == "prefetch" and value == "stride")
+      base.prefetch.kind = PrefetcherKind::Stride;
+    else if (key == "prefetch" and value == "stream")
+      base.prefetch.kind = PrefetcherKind::Stream;
+    else if (key == "degree")
+      base.prefetch.degree = std::stoul(value, nullptr, 0);
+    else if (key == "distance")
+      base.prefetch.distance = std::stoul(value, nullptr, 0);
+    else if (key == "table")
+      base.prefetch.table = std::stoul(value, nullptr, 0);
+    else if (key == "mshrs")
+      base.mshrs = std::stoul(value, nullptr, 0);
+    else if (key == "wbuf")
+      base.write_buffer = std::stoul(value, nullptr, 0);
+    else if (key == "victim")
+      base.victim_lines = std::stoul(value, nullptr, 0);
+    else
+      throw std::runtime_error("unknown cache setting '" + setting + "'");
+  }
+  return base;
+}
+
+CacheConfig parseCacheConfig(const std::string &spec, const CacheConfig base) {
+  const CacheConfig config = parseCacheSettings(spec, base);
+  checkCacheConfig(config);
+  return config;
+}
+
+CacheHierarchy::CacheHierarchy(const HierarchyConfig &config, MainMemory *mainMemory) {
+  // caches whose next level is still to be created
+  std::vector<Cache *> above;
+  const bool split = config.l1i and config.l1d;
+  if (split) {
+    caches.push_back(makeCache(*config.l1i));
+    caches.back()->setName("L1I Cache");
+    icache = caches.back().get();
+    caches.push_back(makeCache(*config.l1d));
+    caches.back()->setName("L1D Cache");
+    dcache = caches.back().get();
+    above = {icache, dcache};
+  }
+
+  for (std::size_t i = 0; i < config.unified.size(); ++i) {
+    caches.push_back(makeCache(config.unified[i]));
+    Cache *cache = caches.back().get();
+    const std::size_t level = split ? i + 2 : i + 1;
+    // a lone cache keeps its traditional name
+    if (split or config.unified.size() > 1)
+      cache->setName("L" + std::to_string(level) + " Cache");
+    if (above.empty())
+      icache = dcache = cache;
+    else if (config.inclusion == Inclusion::Exclusive and config.unified[i].victim_lines)
+      // lines moving up would have to leave the victim cache too
+      throw std::runtime_error("exclusive cache levels have no victim cache");
+    for (Cache *upper : above)
+      cache->addUpper(upper, config.inclusion);
+    above = {cache};
+  }
+
+  for (Cache *cache : above)
+    cache->setMemory(mainMemory);
+}
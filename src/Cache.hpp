@@ -0,0 +1,822 @@
+#ifndef __CACHE_H
+#define __CACHE_H
+
+#include "CacheBuffers.hpp"
+#include "MainMemory.hpp"
+#include "Prefetcher.hpp"
+#include <algorithm> // for std::copy, std::min
+#include <cstdint>   // for std::uint8_t, std::uint64_t
+#include <memory>    // for std::unique_ptr
+#include <optional>  // for std::optional
+#include <random>    // for random number
+#include <string>    // for level names
+#include <tuple>     // for std::tie
+#include <vector>    // for std::vector
+
+enum class WritePolicy { WriteBack, WriteThrough };
+
+enum class ReplacementPolicy { LRU, RANDOM, FIFO };
+
+// size, block_size are in terms of Word
+struct CacheConfig {
+  Word size = 32;
+  Cycle miss_penalty = 4;
+  Cycle hit_time = 10;
+  Word block_size = 2;
+  Word associativity = 2;
+  WritePolicy WP = WritePolicy::WriteThrough;
+  ReplacementPolicy RP = ReplacementPolicy::LRU;
+  // seeds the cache's own generator for RANDOM replacement, so that runs are
+  // reproducible
+  std::uint64_t seed = 0;
+  PrefetcherConfig prefetch;
+  // miss status holding registers, 0 for a blocking cache
+  Word mshrs = 0;
+  // entries of the write buffer to the next level, 0 for none
+  Word write_buffer = 0;
+  // lines of the victim cache, 0 for none
+  Word victim_lines = 0;
+};
+
+// bound on the MSHRs, write buffer entries and victim lines of a cache, which
+// are all searched one by one
+constexpr Word max_buffer_entries = 1024;
+
+// How a cache level relates to the levels above it (closer to the CPU).
+enum class Inclusion {
+  NINE,      // neither inclusive nor exclusive, levels fill independently
+  Inclusive, // evicting a line also evicts it from the levels above
+  Exclusive  // a line lives in this level or a level above, never both
+};
+
+struct CacheStats {
+  std::uint64_t hits = 0, misses = 0;
+  // cycles of all accesses made to this level, including lower levels
+  std::uint64_t cycles = 0;
+};
+
+// Splits addresses into tag, set index and byte offset for caches with the
+// given block size (in terms of Word) and number of sets, both powers of 2.
+class AddressMap final {
+  const Word offset_bits, index_bits;
+  // precomputed from the bit counts above
+  const Word offset_mask, index_mask, tag_shift;
+
+public:
+  static Word takeLog(const Word x) {
+    for (Word i = 0; i < XLEN; ++i)
+      if ((1u << i) == x)
+        return i;
+    throw std::runtime_error("not a power of 2");
+  }
+
+  AddressMap(const Word block_size, const Word sets)
+      : offset_bits(takeLog(block_size * (XLEN / 8))), index_bits(takeLog(sets)),
+        offset_mask((1u << offset_bits) - 1), index_mask((1u << index_bits) - 1),
+        tag_shift(index_bits + offset_bits) {}
+
+  Word getOffset(Word address) const { return address & offset_mask; }
+
+  Word getIndex(Word address) const { return (address >> offset_bits) & index_mask; }
+
+  Word getTag(Word address) const { return address >> tag_shift; }
+
+  Word getAddress(const Word tag, const Word index, const Word offset) const {
+    return tag << tag_shift | index << offset_bits | offset;
+  }
+};
+
+// Interface of every cache, the policies are compiled into the implementations
+// (see CacheImpl) and makeCache picks one for a configuration at runtime.
+class Cache : public MemoryLevel {
+protected:
+  // next level towards main memory
+  MemoryLevel *memory = nullptr;
+  // levels directly above, only tracked for inclusive back-invalidation
+  std::vector<Cache *> uppers;
+  Inclusion inclusion = Inclusion::NINE;
+  // set if the next level is exclusive of this one, so it takes every victim
+  bool victims_to_next = false;
+
+  std::string name = "Cache";
+  CacheStats stats;
+
+  // PC of the instruction making the next access, for PC-indexed prefetchers
+  Word access_PC = no_PC;
+
+public:
+  Cache() = default;
+  virtual ~Cache() = default;
+
+  Cache(Cache &) = delete;
+  Cache(Cache &&) = delete;
+
+  void setMemory(MemoryLevel *memory_) { memory = memory_; }
+
+  void setName(const std::string &name_) { name = name_; }
+
+  const std::string &getName() const { return name; }
+
+  // makes this level the next level of upper under the given inclusion policy
+  void addUpper(Cache *upper, const Inclusion inclusion_) {
+    inclusion = inclusion_;
+    upper->memory = this;
+    upper->victims_to_next = inclusion == Inclusion::Exclusive;
+    if (inclusion == Inclusion::Inclusive)
+      uppers.push_back(upper);
+  }
+
+  const CacheStats &getStats() const { return stats; }
+
+  // set before every access by the memory subsystem, levels below the first
+  // never learn the PC
+  void setPC(const Word PC) { access_PC = PC; }
+
+  bool inBounds(const Word idx, const std::size_t words) const override {
+    return memory->inBounds(idx, words);
+  }
+
+  // Drops every line inside the block of block.size() words at address, for
+  // inclusive back-invalidation. Dirty data of dropped lines is copied into
+  // block and reported through the return value.
+  virtual bool invalidateBlock(const Word address, Span<Word> block) = 0;
+
+  // Checkpointing of the lines, replacement state and statistics. restore
+  // only takes state saved by a cache of the same geometry and policies (its
+  // timing may differ) and returns false, changing nothing, for any other.
+  virtual void save(std::ostream &) {
+    throw std::runtime_error(name + " does not support checkpoints");
+  }
+  virtual bool restore(std::istream &) {
+    throw std::runtime_error(name + " does not support checkpoints");
+  }
+
+  virtual void dump(std::ostream &os) = 0;
+};
+
+// A cache with its write and replacement policies fixed at compile time, so
+// that the access path has no policy branches. Associativity is fixed too
+// unless it is 0, in which case it is taken from the configuration.
+template <WritePolicy WP, ReplacementPolicy RP, Word Associativity>
+class CacheImpl final : public Cache {
+  const Word size, block_size, associativity;
+  const Cycle miss_penalty, hit_time;
+
+  const AddressMap map;
+
+  // Lines are stored as parallel arrays, line i of set s being at
+  // s * associativity + i, so that the tags of a set are contiguous and can be
+  // compared in one sweep. Tags are kept as (tag << 1 | 1) for valid lines and
+  // 0 for invalid ones, which folds the valid check into the tag compare; tags
+  // are at most XLEN - 2 bits wide so the shift never loses bits.
+  std::vector<Word> tags;
+  std::vector<std::uint8_t> dirty;
+  // block_size words per line, all lines in one arena
+  std::vector<Word> data;
+  // holds an evicted line while its replacement is read in
+  std::vector<Word> victim_buffer;
+
+  // Replacement order as age stamps: a line gets a fresh stamp when filled
+  // (and on every hit under LRU) and the victim is the line with the oldest
+  // stamp, so bookkeeping is O(1) per access and victim search is a sweep.
+  std::vector<std::uint64_t> stamps;
+  std::uint64_t clock = 0;
+
+  std::mt19937_64 rng;
+
+  // nullptr without prefetching
+  std::unique_ptr<Prefetcher> prefetcher;
+  // set on lines filled by a prefetch until they are first demanded, along
+  // with the time their data arrives; time is the cycles of the accesses this
+  // cache served, as it sees nothing else
+  std::vector<std::uint8_t> prefetched;
+  std::vector<Cycle> ready;
+  PrefetchStats prefetch_stats;
+  std::vector<Word> candidates;
+
+  // each nullptr unless configured
+  std::unique_ptr<MSHRFile> mshrs;
+  std::unique_ptr<WriteBuffer> write_buffer;
+  std::unique_ptr<VictimCache> victims;
+
+  // lets the compiler see the associativity as a constant when it is one
+  Word ways() const { return Associativity ? Associativity : associativity; }
+
+  Word getOffset(Word address) { return map.getOffset(address); }
+
+  Word getIndex(Word address) { return map.getIndex(address); }
+
+  Word getTag(Word address) { return map.getTag(address); }
+
+  Word getAddress(const Word tag, const Word index, const Word offset) {
+    return map.getAddress(tag, index, offset);
+  }
+
+  Word *lineData(const Word line) { return &data[static_cast<std::size_t>(line) * block_size]; }
+
+  Word getReplacementBlock(const Word index) {
+    const Word first = index * ways();
+    if constexpr (RP == ReplacementPolicy::RANDOM) {
+      Word choice = std::uniform_int_distribution<int>(0, ways() - 1)(rng);
+      return first + choice;
+    } else {
+      // LRU and FIFO only differ in when stamps are refreshed
+      Word victim = first;
+      for (Word line = first + 1; line < first + ways(); ++line)
+        if (stamps[line] < stamps[victim])
+          victim = line;
+      return victim;
+    }
+  }
+
+  // returns the line holding address, or no line (the first line past the
+  // set) on a miss, without touching the replacement state
+  Word lookupLine(const Word address) const {
+    const Word first = map.getIndex(address) * ways();
+    const Word key = map.getTag(address) << 1 | 1;
+
+    // branch-free sweep over the set's tags so the compiler can vectorize it
+    Word way = ways();
+    const Word *set = &tags[first];
+    for (Word i = 0; i < ways(); ++i)
+      way = set[i] == key ? i : way;
+    return first + way;
+  }
+
+  // lookupLine, but hits refresh the replacement state
+  Word findLine(const Word address) {
+    const Word line = lookupLine(address);
+    if constexpr (RP == ReplacementPolicy::LRU)
+      if (isHit(address, line))
+        stamps[line] = clock++;
+    return line;
+  }
+
+  bool isHit(const Word address, const Word line) const {
+    return line != (map.getIndex(address) + 1) * ways();
+  }
+
+  // what an access to a line is for
+  enum class Request {
+    Read,
+    Write,
+    // a block written back from above, which trains no prefetcher and is
+    // never waited for
+    Writeback
+  };
+
+  // returns the line holding address, filling it on a miss
+  std::pair<Word, Cycle> getTableEntry(const Word address, const Request request = Request::Read) {
+    const Word found = findLine(address);
+    const Cycle now = stats.cycles;
+    if (isHit(address, found)) {
+      ++stats.hits;
+      Cycle t = hit_time;
+      if ((prefetcher or mshrs) and request != Request::Writeback) {
+        // the line may still be being filled; a non-blocking cache lets
+        // stores merge into the fill, anything else waits for it
+        const bool in_flight = ready[found] > now;
+        if (in_flight and (request == Request::Read or not mshrs))
+          t += ready[found] - now;
+        if (in_flight and mshrs)
+          ++mshrs->stats.merged;
+        bool trigger = false;
+        if (prefetched[found]) {
+          trigger = true;
+          prefetched[found] = false;
+          ++(in_flight ? prefetch_stats.late : prefetch_stats.useful);
+        }
+        if (prefetcher)
+          prefetch(address, found, trigger);
+      }
+      return {found, t};
+    }
+
+    // a miss waits for a register if all are filling other lines
+    const Cycle stall = mshrs ? mshrs->acquire(now) : 0;
+    auto [line, t_mem, from_victims] =
+        fillLine(address, getReplacementBlock(getIndex(address)));
+    Cycle t;
+    if (from_victims) {
+      ++stats.hits;
+      ++victims->stats.hits;
+      t = hit_time + VictimCache::hit_time + t_mem;
+    } else {
+      ++stats.misses;
+      t = hit_time + miss_penalty + t_mem;
+    }
+    if (mshrs) {
+      mshrs->hold(now + stall + t);
+      // a store goes on while the line is filled around it
+      if (request == Request::Write) {
+        ready[line] = now + stall + t;
+        t = hit_time;
+      }
+      t += stall;
+    }
+    if (prefetcher and request != Request::Writeback)
+      prefetch(address, line, true);
+    return {line, t};
+  }
+
+  // returns the line a whole block written back from above goes into; on a
+  // miss the line is allocated without reading the block it is about to be
+  // overwritten with, which is no demand miss either
+  std::pair<Word, Cycle> allocateLine(const Word address) {
+    const Word found = findLine(address);
+    if (isHit(address, found)) {
+      ++stats.hits;
+      return {found, hit_time};
+    }
+    const Fill fill = fillLine(address, getReplacementBlock(getIndex(address)), false);
+    if (fill.from_victims)
+      ++victims->stats.hits;
+    return {fill.line, hit_time + fill.t_mem};
+  }
+
+  struct Fill {
+    Word line;
+    // cycles of the next level, and whether the victim cache had the block
+    Cycle t_mem;
+    bool from_victims;
+  };
+
+  // brings the block holding address into line, evicting what it held; with
+  // fetch unset the next level is not read, the caller overwrites the line
+  Fill fillLine(const Word address, const Word line, const bool fetch = true) {
+    const Word index = getIndex(address);
+    Cycle t_mem = 0;
+
+    // decide what has to happen to the victim before it is overwritten
+    const bool evicting = tags[line];
+    bool victim_dirty = false;
+    Word victim_address = 0;
+    if (evicting) {
+      victim_address = getAddress(tags[line] >> 1, index, 0);
+      Span<Word> victim(lineData(line), block_size);
+      // under inclusion the levels above lose the line too, and their dirty
+      // data has to leave with it
+      for (Cache *upper : uppers)
+        if (upper->invalidateBlock(victim_address, victim))
+          dirty[line] = true;
+      // lines only get dirty under write-through through back-invalidation
+      victim_dirty = dirty[line];
+      std::copy(victim.begin(), victim.end(), victim_buffer.begin());
+      dropPrefetched(line);
+    }
+
+    // replace victim with new entry, from the victim cache if it has it
+    const Word block = getAddress(getTag(address), index, 0);
+    const Word entry = victims ? victims->find(block) : 0;
+    const bool from_victims = victims and entry != victims->lines();
+    if (from_victims) {
+      std::copy(victims->entryData(entry), victims->entryData(entry) + block_size,
+                lineData(line));
+      dirty[line] = victims->isDirty(entry);
+      victims->remove(entry);
+    } else {
+      if (fetch)
+        t_mem += memory->readBlock(block, Span<Word>(lineData(line), block_size));
+      dirty[line] = false;
+    }
+
+    if (evicting) {
+      if (victims) {
+        // the victim cache takes the line, passing on its oldest if full
+        const Word slot = victims->slot();
+        if (victims->isValid(slot)) {
+          ++victims->stats.evictions;
+          t_mem += writeBack(victims->entryBlock(slot), victims->entryData(slot),
+                             victims->isDirty(slot));
+        }
+        victims->fill(slot, victim_address, victim_buffer.data(), victim_dirty);
+      } else {
+        t_mem += writeBack(victim_address, victim_buffer.data(), victim_dirty);
+      }
+    }
+    tags[line] = getTag(address) << 1 | 1;
+    stamps[line] = clock++;
+    ready[line] = 0;
+    return {line, t_mem, from_victims};
+  }
+
+  // Passes a block leaving this level to the next one if it has to know: if
+  // it is dirty, or if the next level is exclusive of this one and takes every
+  // victim. With a write buffer only a full buffer costs anything.
+  Cycle writeBack(const Word address, const Word *block, const bool is_dirty) {
+    if (not is_dirty and not victims_to_next)
+      return 0;
+    return buffered(address,
+                    memory->writeBlock(address, Span<const Word>(block, block_size), is_dirty));
+  }
+
+  // cycles a write to the next level taking t_write cycles costs this level
+  Cycle buffered(const Word address, const Cycle t_write) {
+    return write_buffer ? write_buffer->push(address & ~(block_size * 4 - 1), t_write, stats.cycles)
+                        : t_write;
+  }
+
+  // a store passed on to the next level
+  Cycle writeThrough(const Word idx, const Word val) {
+    if (write_buffer and write_buffer->coalesce(idx & ~(block_size * 4 - 1), stats.cycles)) {
+      // the queued write carries this store too
+      memory->pokeData(idx, val);
+      return 0;
+    }
+    return buffered(idx, memory->writeData(idx, val));
+  }
+
+  // a line leaving the cache that was prefetched for nothing
+  void dropPrefetched(const Word line) {
+    if (prefetched[line]) {
+      ++prefetch_stats.useless;
+      prefetched[line] = false;
+    }
+  }
+
+  // Asks the prefetcher about a demand access to address, which is now in
+  // line, and fills the blocks it wants. They are fetched as misses would be
+  // but charged to nobody. A prefetch that would evict the demanded line is
+  // dropped, the caller still has to use that line, and so is one finding
+  // every miss register taken.
+  void prefetch(const Word address, const Word demanded, const bool trigger) {
+    candidates.clear();
+    prefetcher->observe(access_PC, address, trigger, candidates);
+    const Word block_bytes = block_size * 4;
+    for (Word candidate : candidates) {
+      candidate &= ~(block_bytes - 1);
+      if (candidate == (address & ~(block_bytes - 1)) or
+          not memory->inBounds(candidate, block_size) or isHit(candidate, lookupLine(candidate)))
+        continue;
+      const Word line = getReplacementBlock(getIndex(candidate));
+      if (line == demanded)
+        continue;
+      if (mshrs and not mshrs->available(stats.cycles)) {
+        ++prefetch_stats.dropped;
+        continue;
+      }
+      const Fill fill = fillLine(candidate, line);
+      prefetched[line] = true;
+      ready[line] = stats.cycles + (fill.from_victims ? VictimCache::hit_time : miss_penalty) +
+                    fill.t_mem;
+      if (mshrs) {
+        mshrs->acquire(stats.cycles);
+        mshrs->hold(ready[line]);
+      }
+      ++prefetch_stats.issued;
+      prefetch_stats.memory_cycles += fill.t_mem;
+      prefetch_stats.words += block_size;
+    }
+  }
+
+  // drops a line from this (exclusive) level, writing it back if dirty since
+  // the level above takes it clean
+  Cycle releaseLine(const Word line, const Word index) {
+    Cycle t = 0;
+    if (dirty[line])
+      t = buffered(getAddress(tags[line] >> 1, index, 0),
+                   memory->writeBlock(getAddress(tags[line] >> 1, index, 0),
+                                      Span<const Word>(lineData(line), block_size)));
+    tags[line] = 0;
+    dirty[line] = false;
+    return t;
+  }
+
+  // the word at idx in the victim cache, or nullptr if it does not hold it
+  Word *victimWord(const Word idx) {
+    if (not victims)
+      return nullptr;
+    const Word entry = victims->find(idx & ~(block_size * 4 - 1));
+    return entry == victims->lines() ? nullptr : victims->entryData(entry) + getOffset(idx) / 4;
+  }
+
+  // runs f(address, words) over the part of [idx, idx + n words) inside each
+  // of this cache's blocks, as a request may cover several of them
+  template <typename F> Cycle forEachBlock(const Word idx, const std::size_t n, F f) {
+    Cycle t = 0;
+    for (std::size_t done = 0; done < n;) {
+      const Word address = idx + 4 * done;
+      const std::size_t count =
+          std::min<std::size_t>(n - done, block_size - getOffset(address) / 4);
+      t += f(address, done, count);
+      done += count;
+    }
+    return t;
+  }
+
+public:
+  CacheImpl(const CacheConfig &config)
+      : size(config.size), block_size(config.block_size),
+        associativity(config.associativity), miss_penalty(config.miss_penalty),
+        hit_time(config.hit_time), map(block_size, size / block_size / associativity),
+        tags(size / block_size, 0), dirty(size / block_size, false), data(size, 0),
+        victim_buffer(block_size), stamps(size / block_size), rng(config.seed),
+        prefetcher(makePrefetcher(config.prefetch, block_size * (XLEN / 8))),
+        prefetched(size / block_size, false), ready(size / block_size, 0) {
+    if (config.mshrs)
+      mshrs = std::make_unique<MSHRFile>(config.mshrs);
+    if (config.write_buffer)
+      write_buffer = std::make_unique<WriteBuffer>(config.write_buffer);
+    if (config.victim_lines)
+      victims = std::make_unique<VictimCache>(config.victim_lines, block_size);
+    if (Associativity != 0 and associativity != Associativity)
+      throw std::runtime_error("cache instantiated with the wrong associativity");
+    // initially ways are replaced in order, as if filled one after another
+    for (Word line = 0; line < size / block_size; ++line)
+      stamps[line] = line % associativity;
+    clock = associativity;
+  }
+
+  std::pair<Word, Cycle> getData(const Word idx) override {
+    auto [line, t] = getTableEntry(idx);
+    Word i = getOffset(idx) / 4;
+    stats.cycles += t;
+    return {lineData(line)[i], t};
+  }
+
+  Cycle writeData(const Word idx, const Word val) override {
+    Cycle t = 0;
+    Word line;
+    if (inclusion == Inclusion::Exclusive) {
+      // written through from above, where the line lives; no allocation here
+      line = findLine(idx);
+      if (not isHit(idx, line)) {
+        ++stats.misses;
+        t = hit_time + writeThrough(idx, val);
+        stats.cycles += t;
+        return t;
+      }
+      ++stats.hits;
+      t = hit_time;
+    } else {
+      std::tie(line, t) = getTableEntry(idx, Request::Write);
+    }
+    Word i = getOffset(idx) / 4;
+    lineData(line)[i] = val;
+    if constexpr (WP == WritePolicy::WriteThrough)
+      t += writeThrough(idx, val);
+    else
+      dirty[line] = true;
+    stats.cycles += t;
+    return t;
+  }
+
+  Word peekData(const Word idx) override {
+    const Word line = lookupLine(idx);
+    if (isHit(idx, line))
+      return lineData(line)[getOffset(idx) / 4];
+    if (Word *word = victimWord(idx))
+      return *word;
+    return memory->peekData(idx);
+  }
+
+  void pokeData(const Word idx, const Word val) override {
+    const Word line = lookupLine(idx);
+    if (isHit(idx, line))
+      lineData(line)[getOffset(idx) / 4] = val;
+    else if (Word *word = victimWord(idx))
+      *word = val;
+    // lower levels may hold (stale) copies too
+    memory->pokeData(idx, val);
+  }
+
+  Cycle readBlock(const Word idx, Span<Word> block) override {
+    const Cycle t = forEachBlock(idx, block.size(), [&](Word address, std::size_t done,
+                                                        std::size_t count) -> Cycle {
+      const Word offset = getOffset(address) / 4;
+      if (inclusion == Inclusion::Exclusive) {
+        // the line moves up, a miss goes around this level without filling it
+        const Word line = findLine(address);
+        if (not isHit(address, line)) {
+          ++stats.misses;
+          return hit_time + miss_penalty + memory->readBlock(address, block.subspan(done, count));
+        }
+        ++stats.hits;
+        std::copy(lineData(line) + offset, lineData(line) + offset + count, &block[done]);
+        return hit_time + releaseLine(line, getIndex(address));
+      }
+      auto [line, t] = getTableEntry(address);
+      std::copy(lineData(line) + offset, lineData(line) + offset + count, &block[done]);
+      return t;
+    });
+    stats.cycles += t;
+    return t;
+  }
+
+  Cycle writeBlock(const Word idx, Span<const Word> block, const bool is_dirty) override {
+    const Cycle t = forEachBlock(idx, block.size(), [&](Word address, std::size_t done,
+                                                        std::size_t count) -> Cycle {
+      auto [line, t] = count == block_size ? allocateLine(address)
+                                           : getTableEntry(address, Request::Writeback);
+      std::copy(&block[done], &block[done] + count, lineData(line) + getOffset(address) / 4);
+      if constexpr (WP == WritePolicy::WriteThrough) {
+        if (is_dirty)
+          t += buffered(address, memory->writeBlock(address, block.subspan(done, count)));
+      } else {
+        dirty[line] = dirty[line] or is_dirty;
+      }
+      return t;
+    });
+    stats.cycles += t;
+    return t;
+  }
+
+  void save(std::ostream &os) override {
+    writeValue(os, size);
+    writeValue(os, block_size);
+    writeValue(os, associativity);
+    writeValue(os, WP);
+    writeValue(os, RP);
+    writeValue(os, victims ? victims->lines() : 0);
+    writeArray(os, tags);
+    writeArray(os, dirty);
+    writeArray(os, data);
+    writeArray(os, stamps);
+    writeValue(os, clock);
+    writeValue(os, stats);
+    writeEngine(os, rng);
+    if (victims)
+      victims->save(os);
+  }
+
+  bool restore(std::istream &is) override {
+    if (readValue<Word>(is) != size or readValue<Word>(is) != block_size or
+        readValue<Word>(is) != associativity or readValue<WritePolicy>(is) != WP or
+        readValue<ReplacementPolicy>(is) != RP or
+        readValue<Word>(is) != (victims ? victims->lines() : 0))
+      return false;
+    readArray(is, tags);
+    readArray(is, dirty);
+    readArray(is, data);
+    readArray(is, stamps);
+    clock = readValue<std::uint64_t>(is);
+    stats = readValue<CacheStats>(is);
+    readEngine(is, rng);
+    if (victims)
+      victims->restore(is);
+    // prefetcher state and accesses in flight are not checkpointed, restored
+    // lines count as demanded and present
+    std::fill(prefetched.begin(), prefetched.end(), false);
+    std::fill(ready.begin(), ready.end(), 0);
+    if (mshrs)
+      mshrs->reset();
+    if (write_buffer)
+      write_buffer->reset();
+    return true;
+  }
+
+  bool invalidateBlock(const Word address, Span<Word> block) override {
+    bool was_dirty = false;
+    forEachBlock(address, block.size(), [&](Word at, std::size_t done,
+                                            std::size_t count) -> Cycle {
+      const Word first = getIndex(at) * ways();
+      const Word key = getTag(at) << 1 | 1;
+      for (Word line = first; line < first + ways(); ++line) {
+        if (tags[line] != key)
+          continue;
+        const Word offset = getOffset(at) / 4;
+        if (dirty[line]) {
+          std::copy(lineData(line) + offset, lineData(line) + offset + count, &block[done]);
+          was_dirty = true;
+        }
+        tags[line] = 0;
+        dirty[line] = false;
+        dropPrefetched(line);
+      }
+      if (victims) {
+        const Word entry = victims->find(at & ~(block_size * 4 - 1));
+        if (entry != victims->lines()) {
+          const Word offset = getOffset(at) / 4;
+          if (victims->isDirty(entry)) {
+            std::copy(victims->entryData(entry) + offset,
+                      victims->entryData(entry) + offset + count, &block[done]);
+            was_dirty = true;
+          }
+          victims->remove(entry);
+        }
+      }
+      return 0;
+    });
+    // lines dropped here may still be held further up
+    for (Cache *upper : uppers)
+      was_dirty = upper->invalidateBlock(address, block) or was_dirty;
+    return was_dirty;
+  }
+
+  void dump(std::ostream &os) override {
+    os << name << "\n";
+    os << std::string(name.size(), '=') << "\n";
+
+    os << "Hits: " << stats.hits << "\tMisses: " << stats.misses << "\n";
+    os << "Miss Rate: "
+       << 100 * static_cast<long double>(stats.misses) / (stats.hits + stats.misses) << "%\n";
+    os << "Access Cycles: " << stats.cycles << "\n";
+    if (prefetcher) {
+      const PrefetchStats &p = prefetch_stats;
+      const std::uint64_t used = p.useful + p.late;
+      os << "Prefetches: " << p.issued << "\tUseful: " << p.useful << "\tLate: " << p.late
+         << "\tUseless: " << p.useless << "\n";
+      os << "Prefetch Accuracy: " << 100 * static_cast<long double>(used) / p.issued
+         << "%\tCoverage: " << 100 * static_cast<long double>(used) / (used + stats.misses)
+         << "%\n";
+      os << "Prefetch Memory Cycles: " << p.memory_cycles << "\tWords: " << p.words << "\n";
+      if (mshrs)
+        os << "Prefetches Dropped: " << p.dropped << "\n";
+    }
+    if (mshrs) {
+      const MSHRStats &m = mshrs->stats;
+      os << "MSHR Allocations: " << m.allocations << "\tMerged: " << m.merged
+         << "\tFull Stalls: " << m.full_stalls << "\tStall Cycles: " << m.stall_cycles << "\n";
+    }
+    if (write_buffer) {
+      const WriteBufferStats &w = write_buffer->stats;
+      os << "Write Buffer Writes: " << w.writes << "\tCoalesced: " << w.coalesced
+         << "\tFull Stalls: " << w.full_stalls << "\tStall Cycles: " << w.stall_cycles
+         << "\tHidden Cycles: " << w.hidden_cycles << "\n";
+    }
+    if (victims) {
+      const VictimCacheStats &v = victims->stats;
+      os << "Victim Cache Hits: " << v.hits << "\tEvictions: " << v.evictions << "\n";
+    }
+
+    // formatting changes
+    char prev_fill = os.fill('0');
+    os << std::hex;
+
+    for (Word line = 0; line < tags.size(); ++line) {
+      if (not tags[line])
+        continue;
+      os << "0x" << std::setw(XLEN / 4)
+         << getAddress(tags[line] >> 1, line / ways(), 0) << " : ";
+      for (Word i = 0; i < block_size; ++i)
+        os << "0x" << std::setw(XLEN / 4) << lineData(line)[i] << " ";
+      os << "\n";
+    }
+    if (victims) {
+      for (Word e = 0; e < victims->lines(); ++e) {
+        if (not victims->isValid(e))
+          continue;
+        os << "0x" << std::setw(XLEN / 4) << victims->entryBlock(e) << " : ";
+        for (Word i = 0; i < block_size; ++i)
+          os << "0x" << std::setw(XLEN / 4) << victims->entryData(e)[i] << " ";
+        os << "(victim)\n";
+      }
+    }
+
+    // reset formatting changes
+    os << std::dec;
+    os.fill(prev_fill);
+  }
+};
+
+// Creates the cache implementation specialized for the configuration's
+// policies and, for common values, its associativity. Throws for configurations
+// checkCacheConfig rejects.
+std::unique_ptr<Cache> makeCache(const CacheConfig &config = {});
+
+// Throws unless config describes a cache that can be built: size, block size
+// and associativity are powers of 2 with room for at least one set, the
+// prefetcher settings are valid and no buffer exceeds max_buffer_entries.
+void checkCacheConfig(const CacheConfig &config);
+
+// Parses a comma separated list of key=value settings, e.g.
+// "size=64,block=4,assoc=4,hit=1,miss=10,write=wb,repl=lru", on top of base.
+// Sizes are in terms of Word. parseCacheSettings leaves checking the result
+// to the caller, parseCacheConfig checks it with checkCacheConfig.
+CacheConfig parseCacheSettings(const std::string &spec, CacheConfig base = {});
+CacheConfig parseCacheConfig(const std::string &spec, CacheConfig base = {});
+
+struct HierarchyConfig {
+  // split first level, used only if both are set
+  std::optional<CacheConfig> l1i, l1d;
+  // unified levels ordered away from the CPU; the first is the L1 unless the
+  // first level is split
+  std::vector<CacheConfig> unified{CacheConfig{}};
+  // relation of each unified level below the first to the levels above it
+  Inclusion inclusion = Inclusion::NINE;
+};
+
+// Owns the caches of a hierarchy and wires them to each other and to main
+// memory.
+class CacheHierarchy final {
+  std::vector<std::unique_ptr<Cache>> caches;
+  Cache *icache = nullptr, *dcache = nullptr;
+
+public:
+  CacheHierarchy(const HierarchyConfig &config, MainMemory *mainMemory);
+
+  // first level for instruction fetches and for data accesses, nullptr if
+  // there are no caches
+  Cache *instructionCache() const { return icache; }
+  Cache *dataCache() const { return dcache; }
+
+  // every level, closest to the CPU first
+  std::vector<Cache *> levels() const {
+    std::vector<Cache *> result;
+    for (auto &cache : caches)
+      result.push_back(cache.get());
+    return result;
+  }
+};
+
+#endif /* end of __CACHE_H */
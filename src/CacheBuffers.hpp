@@ -0,0 +1,211 @@
+#ifndef __CACHE_BUFFERS_H
+#define __CACHE_BUFFERS_H
+
+#include "Serialize.hpp"
+#include <algorithm> // for std::min_element
+#include <cstdint>   // for std::uint8_t, std::uint64_t
+#include <deque>     // for std::deque
+#include <vector>    // for std::vector
+
+// Structures that let a cache overlap its accesses with the levels below.
+// They only see time as the cycles of the accesses their cache served.
+
+struct MSHRStats {
+  // misses that took a register, accesses that waited for a line still being
+  // filled, and misses that found every register taken
+  std::uint64_t allocations = 0, merged = 0, full_stalls = 0, stall_cycles = 0;
+};
+
+// Miss status holding registers: each tracks one fill in flight, so a miss
+// only has to wait for a register if all of them are taken.
+class MSHRFile final {
+  // when each register frees up
+  std::vector<Cycle> busy;
+  std::size_t taken = 0;
+
+public:
+  MSHRStats stats;
+
+  explicit MSHRFile(const Word registers) : busy(registers, 0) {}
+
+  bool available(const Cycle now) const {
+    return *std::min_element(busy.begin(), busy.end()) <= now;
+  }
+
+  // Takes the register that frees first, returning how long the miss waits
+  // for it; hold then sets when the register frees again.
+  Cycle acquire(const Cycle now) {
+    taken = std::min_element(busy.begin(), busy.end()) - busy.begin();
+    if (busy[taken] <= now)
+      return 0;
+    ++stats.full_stalls;
+    stats.stall_cycles += busy[taken] - now;
+    return busy[taken] - now;
+  }
+
+  void hold(const Cycle until) {
+    busy[taken] = until;
+    ++stats.allocations;
+  }
+
+  // fills in flight are not checkpointed
+  void reset() { std::fill(busy.begin(), busy.end(), 0); }
+};
+
+struct WriteBufferStats {
+  // writes handed to the next level, and stores merged into one of them
+  std::uint64_t writes = 0, coalesced = 0;
+  std::uint64_t full_stalls = 0, stall_cycles = 0;
+  // latency of the next level taken off the critical path
+  std::uint64_t hidden_cycles = 0;
+};
+
+// Writes to the next level queue here and drain one after another in the
+// background, so a write only costs anything when the buffer is full. Stores
+// to a block that still has a write queued are merged into it.
+class WriteBuffer final {
+  const Word entries;
+  struct Entry {
+    Word block;
+    Cycle done;
+  };
+  std::deque<Entry> queue;
+  // when the last queued write finishes
+  Cycle drained = 0;
+
+  void retire(const Cycle now) {
+    while (not queue.empty() and queue.front().done <= now)
+      queue.pop_front();
+  }
+
+public:
+  WriteBufferStats stats;
+
+  explicit WriteBuffer(const Word entries_) : entries(entries_) {}
+
+  // whether a store to block can merge into a write still queued
+  bool coalesce(const Word block, const Cycle now) {
+    retire(now);
+    for (const Entry &entry : queue) {
+      if (entry.block == block) {
+        ++stats.coalesced;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // queues a write of block taking t_write cycles, returning the cycles the
+  // writer waits for an entry
+  Cycle push(const Word block, const Cycle t_write, Cycle now) {
+    retire(now);
+    Cycle stall = 0;
+    if (queue.size() == entries) {
+      stall = queue.front().done - now;
+      now = queue.front().done;
+      queue.pop_front();
+      ++stats.full_stalls;
+      stats.stall_cycles += stall;
+    }
+    drained = std::max(drained, now) + t_write;
+    queue.push_back({block, drained});
+    ++stats.writes;
+    stats.hidden_cycles += t_write;
+    return stall;
+  }
+
+  // queued writes are not checkpointed, their data already is below
+  void reset() {
+    queue.clear();
+    drained = 0;
+  }
+};
+
+struct VictimCacheStats {
+  std::uint64_t hits = 0, evictions = 0;
+};
+
+// Small fully associative cache of lines evicted from its cache, which takes
+// them back on a miss instead of going to the next level. Entries are
+// replaced oldest first.
+class VictimCache final {
+  const Word block_size;
+  // block addresses, valid only where valid is set
+  std::vector<Word> blocks;
+  std::vector<std::uint8_t> valid, dirty;
+  std::vector<Word> data;
+  std::vector<std::uint64_t> stamps;
+  std::uint64_t clock = 0;
+
+public:
+  // cycles a hit adds to the cache's hit time
+  static constexpr Cycle hit_time = 1;
+
+  VictimCacheStats stats;
+
+  VictimCache(const Word lines, const Word block_size_)
+      : block_size(block_size_), blocks(lines, 0), valid(lines, false), dirty(lines, false),
+        data(static_cast<std::size_t>(lines) * block_size, 0), stamps(lines, 0) {}
+
+  Word lines() const { return blocks.size(); }
+
+  // entry holding block, or lines() if none does
+  Word find(const Word block) const {
+    for (Word e = 0; e < lines(); ++e)
+      if (valid[e] and blocks[e] == block)
+        return e;
+    return lines();
+  }
+
+  Word *entryData(const Word e) { return &data[static_cast<std::size_t>(e) * block_size]; }
+  Word entryBlock(const Word e) const { return blocks[e]; }
+  bool isValid(const Word e) const { return valid[e]; }
+  bool isDirty(const Word e) const { return dirty[e]; }
+
+  void remove(const Word e) {
+    valid[e] = false;
+    dirty[e] = false;
+  }
+
+  // the entry the next victim goes to, a free one or else the oldest
+  Word slot() const {
+    Word oldest = 0;
+    for (Word e = 0; e < lines(); ++e) {
+      if (not valid[e])
+        return e;
+      if (stamps[e] < stamps[oldest])
+        oldest = e;
+    }
+    return oldest;
+  }
+
+  void fill(const Word e, const Word block, const Word *words, const bool is_dirty) {
+    blocks[e] = block;
+    valid[e] = true;
+    dirty[e] = is_dirty;
+    std::copy(words, words + block_size, entryData(e));
+    stamps[e] = clock++;
+  }
+
+  void save(std::ostream &os) {
+    writeArray(os, blocks);
+    writeArray(os, valid);
+    writeArray(os, dirty);
+    writeArray(os, data);
+    writeArray(os, stamps);
+    writeValue(os, clock);
+    writeValue(os, stats);
+  }
+
+  void restore(std::istream &is) {
+    readArray(is, blocks);
+    readArray(is, valid);
+    readArray(is, dirty);
+    readArray(is, data);
+    readArray(is, stamps);
+    clock = readValue<std::uint64_t>(is);
+    stats = readValue<VictimCacheStats>(is);
+  }
+};
+
+#endif /* end of __CACHE_BUFFERS_H */
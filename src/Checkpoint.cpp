@@ -0,0 +1,71 @@
+/* Checkpointing of a simulation.
+ *
+ * A checkpoint is a header followed by the PC, the cycles and instructions
+ * run so far, the program memory range, the register file, main memory and the caches as
+ * Memory::save writes them, and last the state of the timing model. Everything
+ * but the timing model is streamed out as it is walked, main memory page by
+ * page.
+ */
+#include "Simulation.hpp"
+#include <cstring> // for std::memcmp
+
+namespace {
+
+constexpr char checkpoint_magic[8] = {'R', 'V', 'C', 'K', 'P', 'T', '\0', '\0'};
+constexpr std::uint32_t checkpoint_version = 3;
+
+} // namespace
+
+void Simulation::saveCheckpoint(std::ostream &os) {
+  os.write(checkpoint_magic, sizeof(checkpoint_magic));
+  writeValue(os, checkpoint_version);
+  writeValue(os, PC);
+  writeValue(os, end_PC);
+  writeValue(os, elapsed);
+  writeValue(os, instructions);
+  writeValue(os, program_begin);
+  writeValue(os, program_end);
+  RF.save(os);
+  memory.save(os);
+  // length-prefixed so that a run with another timing model can skip it
+  std::ostringstream timing;
+  writeValue(timing, pipeline ? Timing::Pipeline : event_core ? Timing::Event : Timing::Serial);
+  if (pipeline)
+    pipeline->save(timing);
+  if (event_core)
+    event_core->save(timing);
+  writeString(os, timing.str());
+  if (not os)
+    throw std::runtime_error("cannot write checkpoint");
+}
+
+void Simulation::restoreCheckpoint(std::istream &is) {
+  char magic[sizeof(checkpoint_magic)];
+  if (not is.read(magic, sizeof(magic)) or
+      std::memcmp(magic, checkpoint_magic, sizeof(magic)) != 0)
+    throw std::runtime_error("not a checkpoint");
+  if (readValue<std::uint32_t>(is) != checkpoint_version)
+    throw std::runtime_error("unsupported checkpoint version");
+
+  PC = readValue<Word>(is);
+  end_PC = readValue<Word>(is);
+  elapsed = readValue<Cycle>(is);
+  instructions = readValue<std::uint64_t>(is);
+  Program program;
+  program.entry = PC;
+  program.begin = readValue<Word>(is);
+  program.end = readValue<Word>(is);
+  setup(program);
+  RF.restore(is);
+  memory.restore(is);
+  // the serial model has no state, the others start cold unless the
+  // checkpoint has theirs under the same configuration
+  std::istringstream timing(readString(is));
+  const Timing saved = readValue<Timing>(timing);
+  if (pipeline and not(saved == Timing::Pipeline and pipeline->restore(timing)))
+    diagnostics << "WARNING: the pipeline differs from the checkpoint, it starts cold\n";
+  if (event_core and not(saved == Timing::Event and event_core->restore(timing)))
+    diagnostics << "WARNING: the event core differs from the checkpoint, it starts cold\n";
+  // misses of the checkpointed part of the run are nobody's
+  misses_seen = memory.misses();
+}
@@ -0,0 +1,83 @@
+#ifndef __CODE_WRITES_H
+#define __CODE_WRITES_H
+
+#include "common.hpp"
+#include <functional> // for std::function
+#include <vector>     // for std::vector
+
+// Tracks stores into program memory at page granularity. Stores are counted
+// per page and reported once in the summary, and every store calls the
+// invalidation hooks with the page it hit, so that anything caching decoded
+// code (records, translated blocks) can drop what the store may have changed.
+class CodeWriteTracker final {
+public:
+  // code pages are much smaller than host pages, programs are small and a
+  // store should not invalidate all of them
+  static constexpr Word page_bytes = 256;
+
+  // called with the first and one past the last address of the written page,
+  // clipped to program memory
+  using Hook = std::function<void(Word begin, Word end)>;
+
+private:
+  Word begin = 0, end = 0;
+  // stores per page of program memory
+  std::vector<std::uint64_t> page_writes;
+  std::uint64_t writes = 0;
+  std::vector<Hook> hooks;
+
+public:
+  // starts tracking [begin, end), forgetting the counts and hooks of any
+  // previous program
+  void setRange(const Word begin_, const Word end_) {
+    begin = begin_;
+    end = end_;
+    page_writes.assign((end - begin + page_bytes - 1) / page_bytes, 0);
+    writes = 0;
+    hooks.clear();
+  }
+
+  void addHook(Hook hook) { hooks.push_back(std::move(hook)); }
+
+  // cheap enough for every store, addresses below begin wrap around
+  bool covers(const Word address) const { return address - begin < end - begin; }
+
+  void record(const Word address) {
+    const Word page = (address - begin) / page_bytes;
+    ++page_writes[page];
+    ++writes;
+    const Word page_begin = begin + page * page_bytes;
+    const Word page_end = end - page_begin < page_bytes ? end : page_begin + page_bytes;
+    for (const Hook &hook : hooks)
+      hook(page_begin, page_end);
+  }
+
+  std::uint64_t getWrites() const { return writes; }
+
+  // only prints anything if program memory was written
+  void dump(std::ostream &os) const {
+    if (writes == 0)
+      return;
+    os << "Program Memory Writes\n";
+    os << "=====================\n";
+    Word pages = 0;
+    for (const std::uint64_t n : page_writes)
+      pages += n != 0;
+    os << "Writes: " << writes << "\tPages: " << pages << "\n";
+
+    // formatting changes
+    char prev_fill = os.fill('0');
+    for (Word page = 0; page < page_writes.size(); ++page) {
+      if (page_writes[page] == 0)
+        continue;
+      os << "0x" << std::hex << std::setw(XLEN / 4) << begin + page * page_bytes << std::dec
+         << " : " << page_writes[page] << "\n";
+    }
+
+    // reset formatting changes
+    os.fill(prev_fill);
+    os << "\n";
+  }
+};
+
+#endif /* end of __CODE_WRITES_H */
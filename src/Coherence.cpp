@@ -0,0 +1,268 @@
+#include "Coherence.hpp"
+
+std::pair<MESI, Cycle> Bus::read(CoherentCache *requester, const Word address, Span<Word> block,
+                                 const bool exclusive) {
+  if (not open)
+    throw std::runtime_error("bus transaction while harts are running");
+  ++(exclusive ? stats.read_exclusives : stats.reads);
+  Cycle t = bus_time;
+
+  bool supplied = false, modified = false;
+  for (CoherentCache *cache : caches) {
+    if (cache == requester)
+      continue;
+    const MESI state = cache->snoop(address, block, exclusive);
+    if (state == MESI::Invalid)
+      continue;
+    if (exclusive)
+      ++stats.invalidations;
+    // every holder has the same data, the first one supplies it
+    if (not supplied) {
+      supplied = true;
+      ++stats.interventions;
+      t += cache->hitTime();
+    }
+    modified = modified or state == MESI::Modified;
+  }
+
+  // a dirty line becoming shared is cleaned, as no holder of a Shared line
+  // writes it back; taken for ownership it stays dirty in the requester
+  if (modified and not exclusive) {
+    ++stats.writebacks;
+    t += memory->writeBlock(address, Span<const Word>(block.data(), block.size()));
+  }
+  if (not supplied)
+    t += memory->readBlock(address, block);
+
+  stats.cycles += t;
+  return {exclusive ? MESI::Modified : supplied ? MESI::Shared : MESI::Exclusive, t};
+}
+
+Cycle Bus::upgrade(CoherentCache *requester, const Word address) {
+  if (not open)
+    throw std::runtime_error("bus transaction while harts are running");
+  ++stats.upgrades;
+  // the requester already has the data, other copies are only dropped
+  for (CoherentCache *cache : caches)
+    if (cache != requester and cache->snoop(address, Span<Word>(nullptr, 0), true) != MESI::Invalid)
+      ++stats.invalidations;
+  stats.cycles += bus_time;
+  return bus_time;
+}
+
+Cycle Bus::writeBack(const Word address, Span<const Word> block) {
+  if (not open)
+    throw std::runtime_error("bus transaction while harts are running");
+  ++stats.writebacks;
+  const Cycle t = bus_time + memory->writeBlock(address, block);
+  stats.cycles += t;
+  return t;
+}
+
+void Bus::dump(std::ostream &os) const {
+  os << "Bus\n";
+  os << "===\n";
+  os << "Reads: " << stats.reads << "\tRead Exclusives: " << stats.read_exclusives
+     << "\tUpgrades: " << stats.upgrades << "\n";
+  os << "Interventions: " << stats.interventions << "\tInvalidations: " << stats.invalidations
+     << "\tWritebacks: " << stats.writebacks << "\n";
+  os << "Coherence Cycles: " << stats.cycles << "\n";
+}
+
+CoherentCache::CoherentCache(const CacheConfig &config, Bus *bus_)
+    : size(config.size), block_size(config.block_size), associativity(config.associativity),
+      miss_penalty(config.miss_penalty), hit_time(config.hit_time), RP(config.RP),
+      map(block_size, size / block_size / associativity), bus(bus_), tags(size / block_size, 0),
+      states(size / block_size, MESI::Invalid), data(size, 0), stamps(size / block_size),
+      rng(config.seed) {
+  // initially ways are replaced in order, as if filled one after another
+  for (Word line = 0; line < size / block_size; ++line)
+    stamps[line] = line % associativity;
+  clock = associativity;
+  bus->attach(this);
+}
+
+Word CoherentCache::findLine(const Word address) const {
+  const Word first = map.getIndex(address) * associativity;
+  const Word tag = map.getTag(address);
+  for (Word line = first; line < first + associativity; ++line)
+    if (states[line] != MESI::Invalid and tags[line] == tag)
+      return line;
+  return size / block_size;
+}
+
+Word CoherentCache::getReplacementBlock(const Word index) {
+  const Word first = index * associativity;
+  // invalidated lines are free for the taking
+  for (Word line = first; line < first + associativity; ++line)
+    if (states[line] == MESI::Invalid)
+      return line;
+  if (RP == ReplacementPolicy::RANDOM)
+    return first + std::uniform_int_distribution<Word>(0, associativity - 1)(rng);
+  Word victim = first;
+  for (Word line = first + 1; line < first + associativity; ++line)
+    if (stamps[line] < stamps[victim])
+      victim = line;
+  return victim;
+}
+
+bool CoherentCache::holds(const Word address, const bool write) const {
+  const Word line = findLine(address);
+  if (line == size / block_size)
+    return false;
+  return not write or states[line] != MESI::Shared;
+}
+
+std::optional<Word> CoherentCache::peek(const Word address) const {
+  const Word line = findLine(address);
+  if (line == size / block_size)
+    return std::nullopt;
+  return data[static_cast<std::size_t>(line) * block_size + map.getOffset(address) / 4];
+}
+
+std::pair<Word, Cycle> CoherentCache::access(const Word address, const bool write) {
+  Word line = findLine(address);
+  Cycle t = hit_time;
+
+  if (line != size / block_size) {
+    ++stats.hits;
+    if (RP == ReplacementPolicy::LRU)
+      stamps[line] = clock++;
+    if (write and states[line] == MESI::Shared) {
+      ++upgrades;
+      t += bus->upgrade(this, address);
+    }
+  } else {
+    ++stats.misses;
+    const Word index = map.getIndex(address);
+    line = getReplacementBlock(index);
+    // the victim's data is written back before its line is refilled
+    if (states[line] == MESI::Modified)
+      t += bus->writeBack(map.getAddress(tags[line], index, 0),
+                          Span<const Word>(lineData(line), block_size));
+    MESI state;
+    Cycle t_bus;
+    std::tie(state, t_bus) = bus->read(this, map.getAddress(map.getTag(address), index, 0),
+                                       Span<Word>(lineData(line), block_size), write);
+    t += miss_penalty + t_bus;
+    tags[line] = map.getTag(address);
+    states[line] = state;
+    stamps[line] = clock++;
+  }
+
+  if (write)
+    states[line] = MESI::Modified;
+  return {line, t};
+}
+
+MESI CoherentCache::snoop(const Word address, Span<Word> block, const bool invalidate) {
+  const Word line = findLine(address);
+  if (line == size / block_size)
+    return MESI::Invalid;
+  const MESI state = states[line];
+  std::copy(lineData(line), lineData(line) + block.size(), block.begin());
+  states[line] = invalidate ? MESI::Invalid : MESI::Shared;
+  return state;
+}
+
+std::pair<Word, Cycle> CoherentCache::getData(const Word idx) {
+  auto [line, t] = access(idx, false);
+  stats.cycles += t;
+  return {lineData(line)[map.getOffset(idx) / 4], t};
+}
+
+Cycle CoherentCache::writeData(const Word idx, const Word val) {
+  auto [line, t] = access(idx, true);
+  lineData(line)[map.getOffset(idx) / 4] = val;
+  stats.cycles += t;
+  return t;
+}
+
+Cycle CoherentCache::writeMasked(const Word idx, const Word val, const Word mask) {
+  auto [line, t] = access(idx, true);
+  Word &word = lineData(line)[map.getOffset(idx) / 4];
+  word = (word & ~mask) | (val & mask);
+  stats.cycles += t;
+  return t;
+}
+
+bool CoherentCache::inBounds(const Word, const std::size_t) const {
+  throw std::runtime_error("coherent caches are not used as a lower level");
+}
+
+Word CoherentCache::peekData(const Word) {
+  throw std::runtime_error("functional accesses are not supported with multiple harts");
+}
+
+void CoherentCache::pokeData(const Word, const Word) {
+  throw std::runtime_error("functional accesses are not supported with multiple harts");
+}
+
+// not used as a lower level, blocks are simply moved word by word
+
+Cycle CoherentCache::readBlock(const Word idx, Span<Word> block) {
+  Cycle t = 0;
+  for (std::size_t i = 0; i < block.size(); ++i) {
+    auto [val, t_] = getData(idx + 4 * i);
+    block[i] = val;
+    t += t_;
+  }
+  return t;
+}
+
+Cycle CoherentCache::writeBlock(const Word idx, Span<const Word> block, const bool) {
+  Cycle t = 0;
+  for (std::size_t i = 0; i < block.size(); ++i)
+    t += writeData(idx + 4 * i, block[i]);
+  return t;
+}
+
+bool CoherentCache::invalidateBlock(const Word address, Span<Word> block) {
+  bool was_dirty = false;
+  for (std::size_t done = 0; done < block.size();) {
+    const Word at = address + 4 * done;
+    const std::size_t count =
+        std::min<std::size_t>(block.size() - done, block_size - map.getOffset(at) / 4);
+    const Word line = findLine(at);
+    if (line != size / block_size) {
+      if (states[line] == MESI::Modified) {
+        const Word offset = map.getOffset(at) / 4;
+        std::copy(lineData(line) + offset, lineData(line) + offset + count, &block[done]);
+        was_dirty = true;
+      }
+      states[line] = MESI::Invalid;
+    }
+    done += count;
+  }
+  return was_dirty;
+}
+
+void CoherentCache::dump(std::ostream &os) {
+  os << name << "\n";
+  os << std::string(name.size(), '=') << "\n";
+
+  os << "Hits: " << stats.hits << "\tMisses: " << stats.misses << "\tUpgrades: " << upgrades
+     << "\n";
+  os << "Miss Rate: "
+     << 100 * static_cast<long double>(stats.misses) / (stats.hits + stats.misses) << "%\n";
+  os << "Access Cycles: " << stats.cycles << "\n";
+
+  // formatting changes
+  char prev_fill = os.fill('0');
+  os << std::hex;
+
+  static constexpr char state_names[] = {'I', 'S', 'E', 'M'};
+  for (Word line = 0; line < tags.size(); ++line) {
+    if (states[line] == MESI::Invalid)
+      continue;
+    os << state_names[static_cast<std::size_t>(states[line])] << " 0x" << std::setw(XLEN / 4)
+       << map.getAddress(tags[line], line / associativity, 0) << " : ";
+    for (Word i = 0; i < block_size; ++i)
+      os << "0x" << std::setw(XLEN / 4) << lineData(line)[i] << " ";
+    os << "\n";
+  }
+
+  // reset formatting changes
+  os << std::dec;
+  os.fill(prev_fill);
+}
@@ -0,0 +1,131 @@
+#ifndef __COHERENCE_H
+#define __COHERENCE_H
+
+#include "Cache.hpp"
+#include <cstdint> // for std::uint8_t, std::uint64_t
+#include <random>  // for random replacement
+#include <vector>  // for std::vector
+
+// MESI state of a line in a private cache.
+enum class MESI : std::uint8_t {
+  Invalid,
+  Shared,    // clean, other caches may hold it too
+  Exclusive, // clean, no other cache holds it
+  Modified   // dirty, no other cache holds it
+};
+
+struct BusStats {
+  // transactions by kind: read for sharing, read for ownership, and
+  // invalidation of other copies on a write to a shared line
+  std::uint64_t reads = 0, read_exclusives = 0, upgrades = 0;
+  // lines supplied by another cache, copies invalidated, lines written back
+  std::uint64_t interventions = 0, invalidations = 0, writebacks = 0;
+  // cycles of all transactions, the coherence traffic
+  std::uint64_t cycles = 0;
+};
+
+class CoherentCache;
+
+// Snooping bus connecting the private caches of the harts to main memory.
+// Transactions are only made while every hart is stopped (see MultiHart), so
+// snooping the other caches needs no locking; the bus has to be opened for
+// that time and refuses transactions otherwise.
+class Bus final {
+  MainMemory *memory;
+  std::vector<CoherentCache *> caches;
+  // cycles the bus is held by each transaction, on top of the data transfer
+  const Cycle bus_time;
+  bool open = false;
+  BusStats stats;
+
+public:
+  Bus(MainMemory *memory_, const Cycle bus_time_) : memory(memory_), bus_time(bus_time_) {}
+
+  Bus(Bus &) = delete;
+  Bus(Bus &&) = delete;
+
+  void attach(CoherentCache *cache) { caches.push_back(cache); }
+
+  void setOpen(const bool open_) { open = open_; }
+
+  // Fills block with the line at address for requester, from another cache
+  // if one holds it and from main memory otherwise. With exclusive set the
+  // other copies are invalidated. Returns the state the requester gets.
+  std::pair<MESI, Cycle> read(CoherentCache *requester, const Word address, Span<Word> block,
+                              const bool exclusive);
+
+  // invalidates every copy but the requester's shared one
+  Cycle upgrade(CoherentCache *requester, const Word address);
+
+  Cycle writeBack(const Word address, Span<const Word> block);
+
+  const BusStats &getStats() const { return stats; }
+
+  void dump(std::ostream &os) const;
+};
+
+// A write-back private cache kept coherent with its peers on a Bus by the
+// MESI protocol. Accesses that need no bus transaction (read hits, and write
+// hits on Exclusive or Modified lines) touch nothing outside the cache, which
+// is what lets harts run in parallel between transactions.
+class CoherentCache final : public Cache {
+  const Word size, block_size, associativity;
+  const Cycle miss_penalty, hit_time;
+  const ReplacementPolicy RP;
+  const AddressMap map;
+  Bus *bus;
+
+  // parallel arrays like CacheImpl's, line i of set s at s * associativity + i
+  std::vector<Word> tags;
+  std::vector<MESI> states;
+  std::vector<Word> data;
+  std::vector<std::uint64_t> stamps;
+  std::uint64_t clock = 0;
+  std::mt19937_64 rng;
+
+  // writes to Shared lines, which hit but need the bus
+  std::uint64_t upgrades = 0;
+
+  Word *lineData(const Word line) { return &data[static_cast<std::size_t>(line) * block_size]; }
+
+  // returns the line holding address, or size / block_size if none does
+  Word findLine(const Word address) const;
+
+  Word getReplacementBlock(const Word index);
+
+  // returns the line holding address in a state that allows the access,
+  // making bus transactions as needed
+  std::pair<Word, Cycle> access(const Word address, const bool write);
+
+public:
+  CoherentCache(const CacheConfig &config, Bus *bus_);
+
+  // whether an access can be made without a bus transaction
+  bool holds(const Word address, const bool write) const;
+
+  // the word at address if the cache holds it, without side effects
+  std::optional<Word> peek(const Word address) const;
+
+  // Answers a transaction of another cache for the line at address: copies
+  // the line into block and drops to Shared, or to Invalid with invalidate
+  // set. Returns the state the line had.
+  MESI snoop(const Word address, Span<Word> block, const bool invalidate);
+
+  Cycle hitTime() const { return hit_time; }
+
+  std::pair<Word, Cycle> getData(const Word idx) override;
+  Cycle writeData(const Word idx, const Word val) override;
+  // merges into the line once it is owned, as peekData is not available
+  Cycle writeMasked(const Word idx, const Word val, const Word mask) override;
+  // harts are not fast-forwarded, these throw
+  bool inBounds(const Word idx, const std::size_t words) const override;
+  Word peekData(const Word idx) override;
+  void pokeData(const Word idx, const Word val) override;
+  Cycle readBlock(const Word idx, Span<Word> block) override;
+  Cycle writeBlock(const Word idx, Span<const Word> block, const bool dirty = true) override;
+  bool invalidateBlock(const Word address, Span<Word> block) override;
+
+  void dump(std::ostream &os) override;
+};
+
+#endif /* end of __COHERENCE_H */
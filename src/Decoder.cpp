@@ -0,0 +1,333 @@
+#include "Decoder.hpp"
+#include <array> // for std::array
+
+// The following is necessary to be aligned, but clang-format breaks it.
+// clang-format off
+
+enum class INST_MASKS : Instruction {
+  // The RISC-V ISA keeps the source (rs1 and rs2) and destination (rd)
+  // registers at the same position in all formats to simplify decoding.
+  rs2      = 0b00000001111100000000000000000000,
+  rs1      = 0b00000000000011111000000000000000,
+  rd       = 0b00000000000000000000111110000000,
+  opcode   = 0b00000000000000000000000001111111,
+  // R-type
+  R_funct7 = 0b11111110000000000000000000000000,
+  R_funct3 = 0b00000000000000000111000000000000,
+  // I-Type
+  I_imm    = 0b11111111111100000000000000000000,
+  I_funct3 = 0b00000000000000000111000000000000,
+  // S-type
+  S_imm1   = 0b11111110000000000000000000000000,
+  S_funct3 = 0b00000000000000000111000000000000,
+  S_imm2   = 0b00000000000000000000111110000000,
+  // B-type
+  B_imm1   = 0b10000000000000000000000000000000,
+  B_imm3   = 0b01111110000000000000000000000000,
+  B_funct3 = 0b00000000000000000111000000000000,
+  B_imm4   = 0b00000000000000000000111100000000,
+  B_imm2   = 0b00000000000000000000000010000000,
+  // U-type
+  U_imm    = 0b11111111111111111111000000000000,
+  // J-type
+  J_imm1   = 0b10000000000000000000000000000000,
+  J_imm4   = 0b01111111111000000000000000000000,
+  J_imm3   = 0b00000000000100000000000000000000,
+  J_imm2   = 0b00000000000011111111000000000000
+};
+
+enum class INST_OFFSETS : int {
+  rs2      = 20,
+  rs1      = 15,
+  rd       = 7,
+  opcode   = 0,
+  // R-type
+  R_funct7 = 25,
+  R_funct3 = 12,
+  // I-Type
+  I_imm    = 20,
+  I_funct3 = 12,
+  // S-type
+  S_imm1   = 25,
+  S_funct3 = 12,
+  S_imm2   = 7,
+  // B-type
+  B_imm1   = 31,
+  B_imm3   = 25,
+  B_funct3 = 12,
+  B_imm4   = 8,
+  B_imm2   = 7,
+  // U-type
+  U_imm    = 12,
+  // J-type
+  J_imm1   = 31,
+  J_imm4   = 21,
+  J_imm3   = 20,
+  J_imm2   = 12
+};
+
+#define INST_GET(inst, type) \
+  ((inst & static_cast<Instruction>(INST_MASKS::type)) >> static_cast<int>(INST_OFFSETS::type))
+
+// clang-format on
+
+namespace {
+
+enum class Format : std::uint8_t { R, I, S, B, U, J, None };
+
+// One line of the instruction set: the operation, how its operands are laid
+// out, and the bits (mask) that identify it with the values they must have
+// (match).
+struct InstructionSpec {
+  Operation op;
+  Format format;
+  Instruction mask, match;
+};
+
+constexpr Instruction opcode_mask = static_cast<Instruction>(INST_MASKS::opcode);
+constexpr Instruction funct3_mask = static_cast<Instruction>(INST_MASKS::R_funct3);
+constexpr Instruction funct7_mask = static_cast<Instruction>(INST_MASKS::R_funct7);
+
+constexpr InstructionSpec R(const Operation op, const Instruction funct3,
+                            const Instruction funct7) {
+  return {op, Format::R, funct7_mask | funct3_mask | opcode_mask,
+          funct7 << 25 | funct3 << 12 | 0x33};
+}
+
+constexpr InstructionSpec I(const Operation op, const Instruction opcode,
+                            const Instruction funct3) {
+  return {op, Format::I, funct3_mask | opcode_mask, funct3 << 12 | opcode};
+}
+
+// shifts by an immediate keep funct7 in the upper bits of theirs
+constexpr InstructionSpec shift(const Operation op, const Instruction funct3,
+                                const Instruction funct7) {
+  return {op, Format::I, funct7_mask | funct3_mask | opcode_mask,
+          funct7 << 25 | funct3 << 12 | 0x13};
+}
+
+constexpr InstructionSpec S(const Operation op, const Instruction funct3) {
+  return {op, Format::S, funct3_mask | opcode_mask, funct3 << 12 | 0x23};
+}
+
+constexpr InstructionSpec B(const Operation op, const Instruction funct3) {
+  return {op, Format::B, funct3_mask | opcode_mask, funct3 << 12 | 0x63};
+}
+
+constexpr InstructionSpec U(const Operation op, const Instruction opcode) {
+  return {op, Format::U, opcode_mask, opcode};
+}
+
+// instructions that are one exact word
+constexpr InstructionSpec exact(const Operation op, const Instruction word) {
+  return {op, Format::None, ~Instruction(0), word};
+}
+
+// The instruction set, RV32I followed by the M extension. Instructions that
+// the dispatch key below cannot tell apart must be listed next to each other.
+constexpr InstructionSpec specs[] = {
+    U(Operation::LUI, 0x37),
+    U(Operation::AUIPC, 0x17),
+    {Operation::JAL, Format::J, opcode_mask, 0x6f},
+    I(Operation::JALR, 0x67, 0x0),
+
+    B(Operation::BEQ, 0x0),
+    B(Operation::BNE, 0x1),
+    B(Operation::BLT, 0x4),
+    B(Operation::BGE, 0x5),
+    B(Operation::BLTU, 0x6),
+    B(Operation::BGEU, 0x7),
+
+    I(Operation::LB, 0x03, 0x0),
+    I(Operation::LH, 0x03, 0x1),
+    I(Operation::LW, 0x03, 0x2),
+    I(Operation::LBU, 0x03, 0x4),
+    I(Operation::LHU, 0x03, 0x5),
+    S(Operation::SB, 0x0),
+    S(Operation::SH, 0x1),
+    S(Operation::SW, 0x2),
+
+    I(Operation::ADDI, 0x13, 0x0),
+    I(Operation::SLTI, 0x13, 0x2),
+    I(Operation::SLTIU, 0x13, 0x3),
+    I(Operation::XORI, 0x13, 0x4),
+    I(Operation::ORI, 0x13, 0x6),
+    I(Operation::ANDI, 0x13, 0x7),
+    shift(Operation::SLLI, 0x1, 0x00),
+    shift(Operation::SRLI, 0x5, 0x00),
+    shift(Operation::SRAI, 0x5, 0x20),
+
+    R(Operation::ADD, 0x0, 0x00),
+    R(Operation::SUB, 0x0, 0x20),
+    R(Operation::SLL, 0x1, 0x00),
+    R(Operation::SLT, 0x2, 0x00),
+    R(Operation::SLTU, 0x3, 0x00),
+    R(Operation::XOR, 0x4, 0x00),
+    R(Operation::SRL, 0x5, 0x00),
+    R(Operation::SRA, 0x5, 0x20),
+    R(Operation::OR, 0x6, 0x00),
+    R(Operation::AND, 0x7, 0x00),
+
+    // fences order nothing in a single in-order hart
+    {Operation::FENCE, Format::None, funct3_mask | opcode_mask, 0x0f},
+    exact(Operation::ECALL, 0x00000073),
+    exact(Operation::EBREAK, 0x00100073),
+
+    R(Operation::MUL, 0x0, 0x01),
+    R(Operation::MULH, 0x1, 0x01),
+    R(Operation::MULHSU, 0x2, 0x01),
+    R(Operation::MULHU, 0x3, 0x01),
+    R(Operation::DIV, 0x4, 0x01),
+    R(Operation::DIVU, 0x5, 0x01),
+    R(Operation::REM, 0x6, 0x01),
+    R(Operation::REMU, 0x7, 0x01),
+};
+
+constexpr std::size_t no_of_specs = sizeof(specs) / sizeof(specs[0]);
+
+// Instructions are dispatched on the opcode, funct3 and the two bits of
+// funct7 that RV32IM uses (bit 30 for SUB/SRA, bit 25 for the M extension),
+// 12 bits in all.
+constexpr Instruction key_mask = 1u << 30 | 1u << 25 | funct3_mask | opcode_mask;
+
+constexpr Word dispatchKey(const Instruction I) {
+  return (I & opcode_mask) | (I & funct3_mask) >> 5 | (I >> 20 & 0x400) | (I >> 14 & 0x800);
+}
+
+// the instruction bits a dispatch key stands for
+constexpr Instruction keyBits(const Word key) {
+  return (key & opcode_mask) | (key & 0x380) << 5 | (key & 0x400) << 20 | (key & 0x800) << 14;
+}
+
+// whether some instruction with the given key could be spec
+constexpr bool keyMatches(const InstructionSpec &spec, const Word key) {
+  return (keyBits(key) & spec.mask & key_mask) == (spec.match & key_mask);
+}
+
+// What a dispatch key tells about an instruction: its operation and format,
+// and how to check the bits the key does not cover. Keys of no instruction
+// decode to one of the decoding failures.
+struct DispatchEntry {
+  Operation op = Operation::INVALID_OPCODE;
+  Format format = Format::None;
+  // no_check, funct7_check or the spec the instruction must match
+  std::uint8_t check = 0;
+};
+
+constexpr std::uint8_t no_check = 0xff;
+// funct7 bits outside the key must be clear, true of every instruction with
+// a funct7 in RV32IM and cheaper than matching the spec
+constexpr std::uint8_t funct7_check = 0xfe;
+constexpr Instruction funct7_rest = funct7_mask & ~key_mask;
+static_assert(no_of_specs < funct7_check, "too many instructions for the dispatch table");
+
+constexpr std::array<DispatchEntry, 1u << 12> makeDispatchTable() {
+  std::array<DispatchEntry, 1u << 12> table{};
+  for (Word key = 0; key < table.size(); ++key) {
+    DispatchEntry &entry = table[key];
+    entry.check = no_check;
+    for (std::size_t i = 0; i < no_of_specs; ++i) {
+      if ((specs[i].match & opcode_mask) == (key & opcode_mask))
+        entry.op = Operation::INVALID_INSTRUCTION;
+      if (keyMatches(specs[i], key)) {
+        entry.op = specs[i].op;
+        entry.format = specs[i].format;
+        if ((specs[i].mask & ~key_mask) == funct7_rest and not(specs[i].match & funct7_rest))
+          entry.check = funct7_check;
+        else if (specs[i].mask & ~key_mask)
+          entry.check = static_cast<std::uint8_t>(i);
+        break;
+      }
+    }
+  }
+  return table;
+}
+
+constexpr std::array<DispatchEntry, 1u << 12> dispatch = makeDispatchTable();
+
+// The slow path for keys whose instructions are told apart by more bits: the
+// spec I is among those listed from first on, or nullptr if it is none.
+const InstructionSpec *findSpec(const Instruction I, std::size_t first) {
+  const Word key = dispatchKey(I);
+  for (; first < no_of_specs and keyMatches(specs[first], key); ++first)
+    if ((I & specs[first].mask) == specs[first].match)
+      return &specs[first];
+  return nullptr;
+}
+
+Word sext(Word x, const int width) {
+  const Word mask = 1u << (width - 1); // mask with only <width>th bit set
+  if (x & mask)                        // check if highest (sign) bit is set
+    x |= ~(mask - 1);                  // set all bits other than last <width-1> bits
+  return x;
+}
+
+} // namespace
+
+DecodedInstruction decode(const Instruction I) {
+  DecodedInstruction d;
+  d.raw = I;
+
+  DispatchEntry entry = dispatch[dispatchKey(I)];
+  if (entry.check == funct7_check) {
+    if (I & funct7_rest) {
+      d.op = Operation::INVALID_INSTRUCTION;
+      return d;
+    }
+  } else if (entry.check != no_check and
+             (I & specs[entry.check].mask) != specs[entry.check].match) {
+    const InstructionSpec *spec = findSpec(I, entry.check);
+    if (not spec) {
+      d.op = Operation::INVALID_INSTRUCTION;
+      return d;
+    }
+    entry.op = spec->op;
+    entry.format = spec->format;
+  }
+
+  d.op = entry.op;
+  switch (entry.format) {
+  case Format::R:
+    d.rs1 = INST_GET(I, rs1);
+    d.rs2 = INST_GET(I, rs2);
+    d.rd = INST_GET(I, rd);
+    break;
+
+  case Format::I:
+    d.rs1 = INST_GET(I, rs1);
+    d.rd = INST_GET(I, rd);
+    d.imm = sext(INST_GET(I, I_imm), 12);
+    break;
+
+  case Format::S:
+    d.rs1 = INST_GET(I, rs1);
+    d.rs2 = INST_GET(I, rs2);
+    d.imm = sext(INST_GET(I, S_imm1) << 5 | INST_GET(I, S_imm2), 12);
+    break;
+
+  case Format::B:
+    d.rs1 = INST_GET(I, rs1);
+    d.rs2 = INST_GET(I, rs2);
+    d.imm = INST_GET(I, B_imm1) << 12 | INST_GET(I, B_imm2) << 11 |
+            INST_GET(I, B_imm3) << 5 | INST_GET(I, B_imm4) << 1;
+    d.imm = sext(d.imm, 13);
+    break;
+
+  case Format::U:
+    d.rd = INST_GET(I, rd);
+    d.imm = INST_GET(I, U_imm) << 12;
+    break;
+
+  case Format::J:
+    d.rd = INST_GET(I, rd);
+    d.imm = INST_GET(I, J_imm1) << 20 | INST_GET(I, J_imm2) << 12 |
+            INST_GET(I, J_imm3) << 11 | INST_GET(I, J_imm4) << 1;
+    d.imm = sext(d.imm, 21);
+    break;
+
+  case Format::None:
+    break;
+  }
+
+  return d;
+}
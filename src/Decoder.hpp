@@ -0,0 +1,66 @@
+#ifndef __DECODER_H
+#define __DECODER_H
+
+#include "common.hpp"
+#include <cstdint> // for std::uint8_t
+
+// every operation the simulator knows how to execute, RV32I and the M
+// extension, used to index the handler table of the interpreter; loads,
+// stores and branches are kept contiguous for the range checks below
+enum class Operation : std::uint8_t {
+  // R-type
+  ADD, SUB, SLL, SLT, SLTU, XOR, SRL, SRA, OR, AND,
+  // R-type, M extension
+  MUL, MULH, MULHSU, MULHU, DIV, DIVU, REM, REMU,
+  // I-type
+  ADDI, SLTI, SLTIU, XORI, ORI, ANDI, SLLI, SRLI, SRAI,
+  LB, LH, LW, LBU, LHU,
+  JALR,
+  FENCE, ECALL, EBREAK,
+  // S-type
+  SB, SH, SW,
+  // B-type
+  BEQ, BNE, BLT, BGE, BLTU, BGEU,
+  // U-type
+  LUI, AUIPC,
+  // J-type
+  JAL,
+  // decoding failures, reported only if such an instruction is executed
+  INVALID_OPCODE, INVALID_INSTRUCTION,
+  COUNT
+};
+
+constexpr bool isLoad(const Operation op) { return op >= Operation::LB and op <= Operation::LHU; }
+
+constexpr bool isStore(const Operation op) { return op >= Operation::SB and op <= Operation::SW; }
+
+constexpr bool isBranch(const Operation op) {
+  return op >= Operation::BEQ and op <= Operation::BGEU;
+}
+
+constexpr bool isJump(const Operation op) { return op == Operation::JAL or op == Operation::JALR; }
+
+// An instruction word decoded once into everything execution needs: the
+// operation, register indices and the already sign-extended immediate.
+struct DecodedInstruction {
+  // raw word this record was decoded from, used to detect stale records
+  Instruction raw = 0;
+  Operation op = Operation::INVALID_OPCODE;
+  // destination register, no_of_registers if the instruction has none
+  std::uint8_t rd = no_of_registers;
+  std::uint8_t rs1 = 0, rs2 = 0;
+  Word imm = 0;
+};
+
+constexpr bool isCall(const DecodedInstruction &d) {
+  // ra and t0 are the link registers of the calling convention
+  return isJump(d.op) and (d.rd == 1 or d.rd == 5);
+}
+
+constexpr bool isReturn(const DecodedInstruction &d) {
+  return d.op == Operation::JALR and d.rd == 0 and (d.rs1 == 1 or d.rs1 == 5);
+}
+
+DecodedInstruction decode(const Instruction);
+
+#endif /* end of __DECODER_H */
@@ -1,22 +1,271 @@
 /* It contains the main driver's code for the simulator.
  *
  */
-#include "Simulation.hpp"
+#include "Batch.hpp"
+#include "StackDistance.hpp"
+#include <algorithm> // for std::remove_if
+#include <fstream>   // for writing reports
+
+static void usage() {
+  std::cerr << "Usage: risc-v-sim [options] <binary>\n"
+               "       risc-v-sim [options] --batch=<manifest>\n"
+               "Options:\n"
+               "  --engine=interpreter|block   execution engine (default: interpreter)\n"
+               "  --trace=none|summary|pc|full trace level (default: full)\n"
+               "  --timing=serial|pipeline|event\n"
+               "                               timing model (default: serial)\n"
+               "  --pipeline=<spec>            configure the pipeline model, implies it\n"
+               "  --predictor=<spec>           branch prediction of the pipeline, implies it\n"
+               "  --event-core=<spec>          configure the event core model, implies it\n"
+               "  --profile                    per-PC cycles and misses in the summary\n"
+               "  --profile-csv=<path>         write the per-PC profile as CSV\n"
+               "  --profile-folded=<path>      write the profile as folded stacks\n"
+               "  --symbols=<path>             labels for the profile (asm.py --symbols, nm)\n"
+               "  --trace-file=<path>          write per-instruction trace in binary form\n"
+               "  --access-trace=<path>        write every memory access in compact binary form\n"
+               "  --replay=<path>              feed an access trace to the caches instead of\n"
+               "                               running <binary>\n"
+               "  --format=auto|text|raw|elf   program format (default: auto)\n"
+               "  --load-address=<addr>        load and entry address of raw images\n"
+               "  --memory-size=<bytes>        main memory size, up to 4 GiB (default: 1 KiB)\n"
+               "  --cache=<spec>               unified first level cache\n"
+               "  --l1i=<spec> --l1d=<spec>    split first level caches\n"
+               "  --l2=<spec> --l3=<spec>      unified lower level caches\n"
+               "  --no-cache                   access main memory directly\n"
+               "  --inclusion=nine|inclusive|exclusive\n"
+               "                               relation of lower levels to upper ones\n"
+               "  --sweep=<grid>               replay the run against every cache in grid\n"
+               "  --sweep-threads=<n>          threads replaying the sweep (default: all)\n"
+               "  --miss-curve[=<grid>]        LRU miss rates of every cache size in one pass\n"
+               "  --harts=<n>                  run n harts with coherent private caches\n"
+               "  --hart-threads=<n>           host threads running harts (default: all)\n"
+               "  --quantum=<cycles>           hart synchronization interval (default: 1000)\n"
+               "  --bus-time=<cycles>          cycles per coherence bus transaction (default: 4)\n"
+               "  --sample[=<spec>]            estimate cycles from sampled detail windows\n"
+               "  --checkpoint=<path>          write a checkpoint after --checkpoint-after cycles\n"
+               "  --checkpoint-after=<cycles>  length of the run before checkpointing (default: 0)\n"
+               "  --restore=<path>             resume from a checkpoint, <binary> is optional\n"
+               "  --batch=<manifest>           run every job of the manifest instead of <binary>\n"
+               "  --batch-threads=<n>          threads running batch jobs (default: all)\n"
+               "  --report=<path>              batch report, CSV if path ends in .csv (default:\n"
+               "                               JSON on standard output)\n"
+               "A cache <spec> is a comma separated list of size=<words>, block=<words>,\n"
+               "assoc=<ways>, hit=<cycles>, miss=<cycles>, write=wt|wb, repl=lru|fifo|random,\n"
+               "seed=<n> (of random replacement, default 0), prefetch=none|next|stride|stream,\n"
+               "degree=<blocks>, distance=<blocks>, table=<entries>, mshrs=<n>,\n"
+               "wbuf=<entries> and victim=<lines>.\n"
+               "A sweep <grid> is a cache spec whose values may list alternatives separated\n"
+               "by '|', e.g. size=16|32|64,assoc=1|2|4,write=wt|wb; sweeps need serial timing\n"
+               "and a single --cache level. A miss curve <grid> takes\n"
+               "block=<words>|..., assoc=<ways>|full|... and max=<words>. A sampling <spec>\n"
+               "takes interval=<insts>, warmup=<insts>, detail=<insts> and\n"
+               "confidence=<percent>. A pipeline <spec> takes forward=ex|mem|none\n"
+               "and flush=<cycles>. An event core <spec> takes window=<insts> and\n"
+               "mem=<accesses>. A predictor <spec> is\n"
+               "nottaken|taken|btfn|bimodal|gshare|tournament followed by entries=<n>,\n"
+               "history=<bits>, btb=<entries> and ras=<depth>.\n";
+}
 
 int main(int argc, char **argv) {
-  if (argc != 2) {
-    std::cerr << "Usage: risc-v-sim <binary>\n";
+  Options options;
+  std::vector<std::string> arguments(argv + 1, argv + argc);
+  try {
+    for (const std::string &arg : arguments)
+      parseArgument(arg, options);
+  } catch (std::invalid_argument &) {
+    usage();
+    return 1;
+  } catch (std::exception &e) {
+    std::cerr << "error: " << e.what() << "\n";
     return 1;
   }
 
-  MainMemory mainMemory{};
-  Cache cache{};
-  Memory memory{&mainMemory, &cache};
-  Simulation sim{memory, argv[1]};
+  if (not options.batch_path.empty()) {
+    if (not options.binary_path.empty()) {
+      usage();
+      return 1;
+    }
+    // every other option is a default for the jobs
+    arguments.erase(std::remove_if(arguments.begin(), arguments.end(),
+                                   [](const std::string &arg) {
+                                     return arg.rfind("--batch", 0) == 0 or
+                                            arg.rfind("--report=", 0) == 0;
+                                   }),
+                    arguments.end());
+    try {
+      const std::vector<JobResult> results =
+          runBatch(options.batch_path, arguments, options.batch_threads);
+      const bool csv = options.report_path.size() >= 4 and
+                       options.report_path.compare(options.report_path.size() - 4, 4, ".csv") == 0;
+      if (options.report_path.empty()) {
+        writeReport(std::cout, results, csv);
+      } else {
+        std::ofstream report(options.report_path);
+        if (not report)
+          throw std::runtime_error("cannot write report '" + options.report_path + "'");
+        writeReport(report, results, csv);
+      }
+      // the batch fails if any of its jobs did
+      for (const JobResult &result : results)
+        if (not result.error.empty())
+          return 1;
+    } catch (std::exception &e) {
+      std::cerr << "error: " << e.what() << "\n";
+      return 1;
+    }
+    return 0;
+  }
+
+  if (options.binary_path.empty() and options.restore_path.empty() and
+      options.replay_path.empty()) {
+    usage();
+    return 1;
+  }
+  try {
+    finishOptions(options);
+  } catch (std::exception &e) {
+    std::cerr << "error: " << e.what() << "\n";
+    return 1;
+  }
+  const std::string &binary_path = options.binary_path;
+  SimulationConfig &config = options.config;
+
+  if (options.multi_hart) {
+    MainMemory mainMemory{100, options.memory_size};
+    if (config.trace_level >= TraceLevel::Summary)
+      std::cout << "Beginning the simulation...\n\n";
+    try {
+      MultiHart sim{&mainMemory, binary_path, config, *options.multi_hart};
+      sim.simulate();
+    } catch (std::exception &e) {
+      std::cerr << "error: " << e.what() << "\n";
+    }
+    return 0;
+  }
+
+  std::vector<CacheConfig> sweep;
+  std::optional<MissCurveConfig> miss_curves;
+  try {
+    if (not options.sweep_grid.empty())
+      sweep = parseSweepGrid(options.sweep_grid);
+    if (options.miss_curve_grid)
+      miss_curves = parseMissCurveConfig(*options.miss_curve_grid);
+  } catch (std::exception &e) {
+    std::cerr << "error: " << e.what() << "\n";
+    return 1;
+  }
+  // the tables computed from the recorded accesses are the output of the run
+  const bool record = not sweep.empty() or miss_curves;
+  if (record)
+    config.trace_level = TraceLevel::None;
+
+  MainMemory mainMemory{100, options.memory_size};
+  std::optional<CacheHierarchy> caches;
+  std::optional<Memory> memory;
+  try {
+    if (options.no_cache) {
+      memory.emplace(&mainMemory);
+    } else {
+      caches.emplace(options.hierarchy, &mainMemory);
+      memory.emplace(&mainMemory, *caches);
+    }
+  } catch (std::exception &e) {
+    std::cerr << "error: " << e.what() << "\n";
+    return 1;
+  }
+
+  if (not options.replay_path.empty()) {
+    try {
+      const ReplayResult replay = replayTrace(options.replay_path, *memory);
+      if (config.trace_level >= TraceLevel::Summary) {
+        std::cout << "Replayed " << replay.recorded.accesses << " accesses\n";
+        std::cout << "Total simulation cycles : "
+                  << replay.recorded.base_cycles + replay.memory_cycles << "\n\n";
+        memory->dump(std::cout);
+      }
+    } catch (std::exception &e) {
+      std::cerr << "error: " << e.what() << "\n";
+      return 1;
+    }
+    return 0;
+  }
+
+  AccessTrace trace;
+  if (record)
+    memory->setRecorder(&trace);
+  std::optional<AccessTraceWriter> access_trace;
+  try {
+    if (not options.access_trace_path.empty()) {
+      access_trace.emplace(options.access_trace_path);
+      memory->setRecorder(&*access_trace);
+    }
+  } catch (std::exception &e) {
+    std::cerr << "error: " << e.what() << "\n";
+    return 1;
+  }
 
-  std::cout << "Beginning the simulation...\n\n";
+  if (config.trace_level >= TraceLevel::Summary)
+    std::cout << "Beginning the simulation...\n\n";
   try {
-    sim.simulate();
+    Simulation sim{*memory, binary_path, config};
+    auto restore = [&] {
+      std::ifstream checkpoint(options.restore_path, std::ios::binary);
+      if (not checkpoint)
+        throw std::runtime_error("cannot read checkpoint '" + options.restore_path + "'");
+      sim.restoreCheckpoint(checkpoint);
+    };
+    Cycle total = 0;
+    if (options.sampling) {
+      if (options.restore_path.empty())
+        sim.start();
+      else
+        restore();
+      sim.sample(*options.sampling);
+    } else if (not options.checkpoint_path.empty()) {
+      sim.start();
+      sim.runUntil(~Word(0), options.checkpoint_after);
+      std::ofstream checkpoint(options.checkpoint_path, std::ios::binary);
+      if (not checkpoint)
+        throw std::runtime_error("cannot write checkpoint '" + options.checkpoint_path + "'");
+      sim.saveCheckpoint(checkpoint);
+      if (config.trace_level >= TraceLevel::Summary)
+        std::cout << "Checkpoint written after " << sim.getCycles() << " cycles\n";
+      if (access_trace)
+        access_trace->close(sim.getCycles() - access_trace->getMemoryCycles());
+      return 0;
+    } else if (not options.restore_path.empty()) {
+      restore();
+      total = sim.resume();
+    } else {
+      total = sim.simulate();
+    }
+    if (access_trace)
+      access_trace->close(total - access_trace->getMemoryCycles());
+    if (const Profiler *profiler = sim.getProfiler()) {
+      auto write = [&](const std::string &path, void (Profiler::*writer)(std::ostream &) const) {
+        if (path.empty())
+          return;
+        std::ofstream file(path);
+        if (not file)
+          throw std::runtime_error("cannot write profile '" + path + "'");
+        (profiler->*writer)(file);
+      };
+      write(options.profile_csv_path, &Profiler::writeCSV);
+      write(options.profile_folded_path, &Profiler::writeFolded);
+    }
+    if (not sweep.empty()) {
+      const std::vector<SweepResult> results =
+          runSweep(trace, total - trace.getMemoryCycles(), sweep, options.sweep_threads);
+      if (results.size() < sweep.size())
+        std::cerr << "WARNING: " << sweep.size() - results.size() << " of the " << sweep.size()
+                  << " configurations of the sweep are not valid caches and were left out\n";
+      printSweep(std::cout, results);
+    }
+    if (miss_curves) {
+      if (not sweep.empty())
+        std::cout << "\n";
+      printMissCurves(std::cout, computeMissCurves(trace, *miss_curves));
+    }
   } catch (std::exception &e) {
     std::cerr << "error: " << e.what() << "\n";
   }
@@ -0,0 +1,158 @@
+#include "EventCore.hpp"
+#include "Serialize.hpp"
+#include "Sweep.hpp" // for parseGridAxes
+#include <algorithm> // for std::max
+
+EventCoreConfig parseEventCoreConfig(const std::string &spec, EventCoreConfig config) {
+  for (const auto &[key, values] : parseGridAxes(spec)) {
+    if (values.size() != 1)
+      throw std::runtime_error("event core setting '" + key + "' takes a single value");
+    if (key == "window")
+      config.window = std::stoul(values[0]);
+    else if (key == "mem")
+      config.memory_ops = std::stoul(values[0]);
+    else
+      throw std::runtime_error("unknown event core setting '" + key + "'");
+  }
+  if (config.window == 0 or config.memory_ops == 0)
+    throw std::runtime_error("the event core needs room for an instruction and an access");
+  return config;
+}
+
+EventCore::EventCore(const EventCoreConfig &config_, const PipelineConfig &front_end)
+    : config(config_), flush(front_end.flush), commits(config.window, 0) {
+  if (front_end.predictor)
+    predictor.emplace(*front_end.predictor);
+}
+
+void EventCore::runUntil(const Cycle when) {
+  events.runUntil(when, [this](const Event &) { --memory_in_flight; });
+}
+
+Cycle EventCore::retire(const DecodedInstruction &d, const Word PC, const Word next_PC,
+                        const Cycle t_fetch, const Cycle t_memory) {
+  // FETCH, once the instruction window places before this one has committed
+  Cycle fetch = std::max(fetch_free, redirect);
+  stats.flush_cycles += fetch - fetch_free;
+  Cycle &slot = commits[sequence++ % config.window];
+  if (slot > fetch) {
+    stats.window_stalls += slot - fetch;
+    fetch = slot;
+  }
+  const Cycle fetched = fetch + t_fetch;
+  fetch_free = fetched;
+
+  // ISSUE, in order and a cycle after decode, once the operands are ready;
+  // unused sources are r0, which is always ready
+  const Cycle in_order = std::max(fetched + 1, last_issue + 1);
+  Cycle issue = std::max({in_order, ready[d.rs1], ready[d.rs2]});
+  stats.data_stalls += issue - in_order;
+  // loads and stores also need a free memory slot, and as those free up in
+  // any order waiting is a jump to the next completion event
+  const bool memory = isLoad(d.op) or isStore(d.op);
+  runUntil(issue);
+  if (memory) {
+    while (memory_in_flight == config.memory_ops) {
+      const Cycle next = events.next();
+      stats.memory_stalls += next - issue;
+      runUntil(next);
+      issue = next;
+    }
+  }
+  last_issue = issue;
+
+  // COMPLETE, results are forwarded to instructions issuing from then on
+  Cycle complete = issue + 1;
+  if (memory) {
+    const Cycle t_mem = std::max<Cycle>(t_memory, 1);
+    const Cycle access = complete;
+    complete += t_mem;
+    ++memory_in_flight;
+    events.schedule(complete, {});
+    stats.memory_cycles += t_mem;
+    if (complete > std::max(access, memory_until))
+      stats.memory_busy += complete - std::max(access, memory_until);
+    memory_until = std::max(memory_until, complete);
+  }
+  if (d.rd != no_of_registers and d.rd != 0)
+    ready[d.rd] = complete;
+
+  // COMMIT, in order and a cycle after completing
+  const Cycle commit = std::max(complete, last_commit) + 1;
+  slot = commit;
+
+  // branches and jumps are resolved as they issue while fetch went on with
+  // its prediction; if that was wrong fetch restarts flush cycles after the
+  // one following issue would have
+  const bool mispredicted = predictor ? not predictor->resolve(d, PC, next_PC)
+                                      : isJump(d.op) or next_PC != PC + 4;
+  if (mispredicted)
+    redirect = issue - 1 + flush;
+
+  const Cycle t = commit - last_commit;
+  last_commit = commit;
+  ++stats.instructions;
+  stats.cycles += t;
+  return t;
+}
+
+void EventCore::save(std::ostream &os) const {
+  writeValue(os, config.window);
+  writeValue(os, config.memory_ops);
+  writeValue(os, flush);
+  writeValue(os, predictor.has_value());
+  if (predictor)
+    predictor->save(os);
+  events.save(os);
+  writeValue(os, memory_in_flight);
+  writeArray(os, commits);
+  writeValue(os, sequence);
+  writeValue(os, ready);
+  writeValue(os, fetch_free);
+  writeValue(os, redirect);
+  writeValue(os, last_issue);
+  writeValue(os, last_commit);
+  writeValue(os, memory_until);
+  writeValue(os, stats);
+}
+
+bool EventCore::restore(std::istream &is) {
+  if (readValue<Word>(is) != config.window or readValue<Word>(is) != config.memory_ops or
+      readValue<Cycle>(is) != flush or readValue<bool>(is) != predictor.has_value())
+    return false;
+  if (predictor and not predictor->restore(is))
+    return false;
+  events.restore(is);
+  memory_in_flight = readValue<Word>(is);
+  readArray(is, commits);
+  sequence = readValue<std::uint64_t>(is);
+  ready = readValue<decltype(ready)>(is);
+  fetch_free = readValue<Cycle>(is);
+  redirect = readValue<Cycle>(is);
+  last_issue = readValue<Cycle>(is);
+  last_commit = readValue<Cycle>(is);
+  memory_until = readValue<Cycle>(is);
+  stats = readValue<EventCoreStats>(is);
+  return true;
+}
+
+void EventCore::dump(std::ostream &os) const {
+  os << "Event Core\n";
+  os << "==========\n";
+  os << "Instructions: " << stats.instructions << "\tCycles: " << stats.cycles << "\tCPI: "
+     << static_cast<long double>(stats.cycles) / stats.instructions << "\n";
+  os << "Window Stalls: " << stats.window_stalls << "\tData Stalls: " << stats.data_stalls
+     << "\tMemory Slot Stalls: " << stats.memory_stalls
+     << "\tBranch Flush Cycles: " << stats.flush_cycles << "\n";
+  os << "Memory Cycles: " << stats.memory_cycles << "\tMemory Level Parallelism: "
+     << (stats.memory_busy ? static_cast<long double>(stats.memory_cycles) / stats.memory_busy
+                           : 0)
+     << "\n";
+  os << "Events: " << events.stats.handled << "\tCycles With Events: "
+     << events.stats.active_cycles << "\tCycles Skipped: "
+     << events.now() - std::min<Cycle>(events.now(), events.stats.active_cycles) << "\n";
+  if (predictor) {
+    os << "\n";
+    predictor->dump(os);
+  }
+}
@@ -0,0 +1,98 @@
+#ifndef __EVENT_CORE_H
+#define __EVENT_CORE_H
+
+#include "EventQueue.hpp"
+#include "Pipeline.hpp"
+#include <array>    // for std::array
+#include <cstdint>  // for std::uint64_t
+#include <optional> // for std::optional
+#include <string>
+#include <vector>   // for std::vector
+
+struct EventCoreConfig {
+  // instructions fetched but not yet committed
+  Word window = 16;
+  // loads and stores in flight at once
+  Word memory_ops = 4;
+};
+
+// Parses "window=<insts>,mem=<accesses>" on top of base.
+EventCoreConfig parseEventCoreConfig(const std::string &spec, EventCoreConfig base = {});
+
+struct EventCoreStats {
+  std::uint64_t instructions = 0;
+  Cycle cycles = 0;
+  // cycles fetch waited for room in the window, issue waited for operands
+  // and for a free memory slot
+  Cycle window_stalls = 0, data_stalls = 0, memory_stalls = 0;
+  // fetch cycles lost to mispredicted branches and jumps
+  Cycle flush_cycles = 0;
+  // latencies of all memory accesses, and the cycles at least one was in
+  // flight; their ratio is the memory level parallelism
+  Cycle memory_cycles = 0, memory_busy = 0;
+};
+
+// Timing of a core whose memory accesses overlap, over the functional core.
+// Fetch runs ahead of execution, one fetch in flight, into a window of
+// instructions that commit in order. Instructions issue in order, one per
+// cycle, once fetched and once their operands are ready, and then complete
+// on their own: an ALU result after a cycle, a load or store after its memory
+// latency, with several loads and stores in flight. Loads and stores free
+// their slots in whatever order they complete, so their completions are
+// events of an EventQueue, and an access waiting for a slot jumps to the next
+// one rather than stepping through the cycles in between. Everything that
+// completes in order (results, commits) is kept as plain cycle counts.
+class EventCore final {
+  const EventCoreConfig config;
+  // branch handling is shared with the pipeline model
+  const Cycle flush;
+  std::optional<BranchPredictor> predictor;
+
+  // loads and stores completing
+  struct Event {};
+  EventQueue<Event> events;
+  Word memory_in_flight = 0;
+
+  // commit cycles of the last window instructions, a ring indexed by the
+  // instruction count
+  std::vector<Cycle> commits;
+  std::uint64_t sequence = 0;
+  // earliest cycle each register's value can be used by an issuing
+  // instruction
+  std::array<Cycle, no_of_registers> ready{};
+
+  // when the fetch unit is free again, and the earliest fetch after a
+  // mispredicted branch or jump
+  Cycle fetch_free = 0, redirect = 0;
+  Cycle last_issue = 0, last_commit = 0;
+  // end of the last stretch with memory accesses in flight
+  Cycle memory_until = 0;
+
+  EventCoreStats stats;
+
+  // handles every completion up to when
+  void runUntil(const Cycle when);
+
+public:
+  EventCore(const EventCoreConfig &config_, const PipelineConfig &front_end);
+
+  // Accounts for an instruction that executed at PC and continued at next_PC,
+  // with the given fetch and memory access latencies (0 for no access).
+  // Returns the cycles it added to the run, from the previous instruction
+  // committing to this one committing.
+  Cycle retire(const DecodedInstruction &d, const Word PC, const Word next_PC,
+               const Cycle t_fetch, const Cycle t_memory);
+
+  const EventCoreStats &getStats() const { return stats; }
+
+  // Checkpointing of the window, pending completions, operand readiness,
+  // predictor and statistics. restore only takes state saved by an event core
+  // of the same configuration and returns false, changing nothing, for any
+  // other.
+  void save(std::ostream &os) const;
+  bool restore(std::istream &is);
+
+  void dump(std::ostream &os) const;
+};
+
+#endif /* end of __EVENT_CORE_H */
@@ -0,0 +1,186 @@
+#ifndef __EVENT_QUEUE_H
+#define __EVENT_QUEUE_H
+
+#include "Serialize.hpp"
+#include "common.hpp"
+#include <array>      // for std::array
+#include <cstdint>    // for std::uint64_t
+#include <functional> // for std::greater
+#include <queue>      // for std::priority_queue
+#include <vector>     // for std::vector
+
+struct EventQueueStats {
+  std::uint64_t handled = 0;
+  // cycles that had events, the others were jumped over
+  Cycle active_cycles = 0;
+};
+
+// Discrete event scheduler. Events of the next `slots` cycles sit in a timing
+// wheel with one slot per cycle, events further out in a heap from which they
+// move into the wheel as time catches up with them. The earliest event is
+// kept at hand and, once its cycle is handled, the next one is found in a few
+// word scans of a bitmap of the occupied slots, so idle stretches are skipped
+// rather than stepped through cycle by cycle. Events of the same cycle are
+// handled in the order they were scheduled.
+template <typename Event> class EventQueue final {
+  static constexpr Cycle slots = 1024;
+  static constexpr unsigned word_bits = 64;
+  static constexpr std::size_t words = slots / word_bits;
+
+  struct Far {
+    Cycle when;
+    // keeps events of the same cycle in scheduling order
+    std::uint64_t order;
+    Event event;
+    bool operator>(const Far &other) const {
+      return when != other.when ? when > other.when : order > other.order;
+    }
+  };
+
+  // every slot is a list of nodes in scheduling order, nodes of handled
+  // events are reused
+  static constexpr std::uint32_t none = ~0u;
+  struct Node {
+    Event event;
+    std::uint32_t next;
+  };
+  std::vector<Node> nodes;
+  std::uint32_t free_nodes = none;
+  std::array<std::uint32_t, slots> head, tail;
+  std::array<std::uint64_t, words> occupied{};
+  std::priority_queue<Far, std::vector<Far>, std::greater<Far>> far;
+  std::uint64_t far_order = 0;
+  std::size_t pending = 0;
+  // cycle of the earliest event, if there is any
+  Cycle soonest = 0;
+  Cycle current = 0;
+
+  void place(const Cycle when, const Event &event) {
+    std::uint32_t n = free_nodes;
+    if (n != none) {
+      free_nodes = nodes[n].next;
+      nodes[n] = {event, none};
+    } else {
+      n = nodes.size();
+      nodes.push_back({event, none});
+    }
+    const std::size_t slot = when % slots;
+    if (head[slot] == none) {
+      head[slot] = n;
+      occupied[slot / word_bits] |= std::uint64_t(1) << (slot % word_bits);
+    } else {
+      nodes[tail[slot]].next = n;
+    }
+    tail[slot] = n;
+  }
+
+  // moves time forward, bringing the heap events now in reach into the wheel
+  void advance(const Cycle to) {
+    current = to;
+    while (not far.empty() and far.top().when < current + slots) {
+      place(far.top().when, far.top().event);
+      far.pop();
+    }
+  }
+
+  // finds the earliest event, the queue must not be empty
+  Cycle scan() const {
+    const std::size_t start = current % slots;
+    // from the slot of now to the end of the wheel, then around to it
+    for (std::size_t i = 0; i <= words; ++i) {
+      const std::size_t w = (start / word_bits + i) % words;
+      std::uint64_t bits = occupied[w];
+      if (i == 0)
+        bits &= ~std::uint64_t(0) << (start % word_bits);
+      if (bits != 0) {
+        const std::size_t slot = w * word_bits + __builtin_ctzll(bits);
+        return current + (slot + slots - start) % slots;
+      }
+    }
+    // the wheel is empty, and heap events all come after its horizon anyway
+    return far.top().when;
+  }
+
+public:
+  EventQueueStats stats;
+
+  EventQueue() {
+    head.fill(none);
+    tail.fill(none);
+  }
+
+  Cycle now() const { return current; }
+  bool empty() const { return pending == 0; }
+
+  // when must not be before now
+  void schedule(const Cycle when, const Event &event) {
+    if (pending == 0 or when < soonest)
+      soonest = when;
+    if (when - current < slots)
+      place(when, event);
+    else
+      far.push({when, far_order++, event});
+    ++pending;
+  }
+
+  // cycle of the earliest event, the queue must not be empty
+  Cycle next() const { return soonest; }
+
+  // Checkpointing of the time, the statistics and the pending events in the
+  // order they are to be handled. restore takes the place of a fresh queue.
+  void save(std::ostream &os) const {
+    writeValue(os, current);
+    writeValue(os, stats);
+    writeValue<std::uint64_t>(os, pending);
+    // the wheel holds the events of the slots cycles from now on
+    for (Cycle i = 0; i < slots; ++i) {
+      for (std::uint32_t n = head[(current + i) % slots]; n != none; n = nodes[n].next) {
+        writeValue(os, current + i);
+        writeValue(os, nodes[n].event);
+      }
+    }
+    for (auto rest = far; not rest.empty(); rest.pop()) {
+      writeValue(os, rest.top().when);
+      writeValue(os, rest.top().event);
+    }
+  }
+
+  void restore(std::istream &is) {
+    current = readValue<Cycle>(is);
+    stats = readValue<EventQueueStats>(is);
+    for (auto n = readValue<std::uint64_t>(is); n > 0; --n) {
+      const Cycle when = readValue<Cycle>(is);
+      schedule(when, readValue<Event>(is));
+    }
+  }
+
+  // Handles every event up to and including cycle until in order, and moves
+  // time to until. Handlers may schedule events, even for the cycle being
+  // handled.
+  template <typename Handler> void runUntil(const Cycle until, Handler &&handle) {
+    while (pending > 0 and soonest <= until) {
+      const Cycle when = soonest;
+      advance(when);
+      const std::size_t slot = when % slots;
+      // handlers may append to the slot while it is walked
+      while (head[slot] != none) {
+        const std::uint32_t n = head[slot];
+        const Event event = nodes[n].event;
+        --pending;
+        ++stats.handled;
+        handle(event);
+        head[slot] = nodes[n].next;
+        nodes[n].next = free_nodes;
+        free_nodes = n;
+      }
+      occupied[slot / word_bits] &= ~(std::uint64_t(1) << (slot % word_bits));
+      ++stats.active_cycles;
+      if (pending > 0)
+        soonest = scan();
+    }
+    if (until > current)
+      advance(until);
+  }
+};
+
+#endif /* end of __EVENT_QUEUE_H */
@@ -0,0 +1,158 @@
+#include "Loader.hpp"
+#include <algorithm>  // for std::equal
+#include <cstdint>    // for ELF field types
+#include <fcntl.h>    // for open
+#include <fstream>    // for reading text programs
+#include <sys/mman.h> // for mmap
+#include <sys/stat.h> // for fstat
+#include <unistd.h>   // for close
+
+namespace {
+
+// Read-only mapping of a whole file, unmapped on destruction.
+class MappedFile final {
+  const unsigned char *bytes = nullptr;
+  std::size_t length = 0;
+
+public:
+  // returns an empty mapping for files that cannot be mapped (e.g. pipes)
+  explicit MappedFile(const std::string &path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+      throw std::runtime_error("File '" + path + "' does not exist!");
+    struct stat st;
+    if (fstat(fd, &st) == 0 and S_ISREG(st.st_mode) and st.st_size > 0) {
+      void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (p != MAP_FAILED) {
+        bytes = static_cast<const unsigned char *>(p);
+        length = st.st_size;
+      }
+    }
+    close(fd);
+  }
+
+  ~MappedFile() {
+    if (bytes)
+      munmap(const_cast<unsigned char *>(bytes), length);
+  }
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile(MappedFile &&) = delete;
+
+  bool mapped() const { return bytes != nullptr; }
+  const unsigned char *data() const { return bytes; }
+  std::size_t size() const { return length; }
+};
+
+// ELF32 structures, as laid out in a little-endian file
+struct Elf32Header {
+  unsigned char ident[16];
+  std::uint16_t type, machine;
+  std::uint32_t version, entry, phoff, shoff, flags;
+  std::uint16_t ehsize, phentsize, phnum, shentsize, shnum, shstrndx;
+};
+
+struct Elf32ProgramHeader {
+  std::uint32_t type, offset, vaddr, paddr, filesz, memsz, flags, align;
+};
+
+constexpr unsigned char elf_magic[4] = {0x7f, 'E', 'L', 'F'};
+constexpr unsigned char elf_class_32 = 1, elf_data_lsb = 1;
+constexpr std::uint16_t elf_machine_riscv = 243;
+constexpr std::uint32_t elf_pt_load = 1, elf_pf_x = 1;
+
+bool isELF(const MappedFile &file) {
+  return file.size() >= sizeof(elf_magic) and
+         std::equal(std::begin(elf_magic), std::end(elf_magic), file.data());
+}
+
+Word roundUpToWord(const Word x) { return (x + 3) & ~3u; }
+
+Program loadText(Memory &memory, const std::string &path) {
+  std::ifstream file(path);
+  if (!file)
+    throw std::runtime_error("File '" + path + "' does not exist!");
+
+  Word idx = 0;
+  for (std::string line; std::getline(file, line); idx += ILEN / 8) {
+    if (line.length() != ILEN)
+      throw std::runtime_error("Binary file is not of the correct format!");
+    Instruction inst = 0;
+    for (int i = 0; i < ILEN; ++i)
+      inst = (inst << 1) | (line[i] == '1');
+    memory.writeDataToMainMemory(idx, inst);
+  }
+  return {0, 0, idx};
+}
+
+Program loadRaw(Memory &memory, const MappedFile &file, const Word load_address) {
+  if (load_address & 3)
+    throw std::runtime_error("load address must be word-aligned");
+  memory.loadToMainMemory(load_address, file.data(), file.size());
+  return {load_address, load_address, load_address + roundUpToWord(file.size())};
+}
+
+Program loadELF(Memory &memory, const MappedFile &file) {
+  Elf32Header eh;
+  if (file.size() < sizeof(eh))
+    throw std::runtime_error("truncated ELF header");
+  std::memcpy(&eh, file.data(), sizeof(eh));
+
+  if (eh.ident[4] != elf_class_32 or eh.ident[5] != elf_data_lsb)
+    throw std::runtime_error("only little-endian ELF32 files are supported");
+  if (eh.machine != elf_machine_riscv)
+    throw std::runtime_error("not a RISC-V executable");
+  if (eh.phentsize != sizeof(Elf32ProgramHeader) or
+      eh.phoff + static_cast<std::size_t>(eh.phnum) * eh.phentsize > file.size())
+    throw std::runtime_error("malformed ELF program headers");
+
+  Program program{eh.entry, 0, 0};
+  bool found_entry = false;
+  for (unsigned i = 0; i < eh.phnum; ++i) {
+    Elf32ProgramHeader ph;
+    std::memcpy(&ph, file.data() + eh.phoff + i * sizeof(ph), sizeof(ph));
+    if (ph.type != elf_pt_load)
+      continue;
+    if (static_cast<std::size_t>(ph.offset) + ph.filesz > file.size() or ph.filesz > ph.memsz)
+      throw std::runtime_error("malformed ELF segment");
+    // main memory starts zeroed, so the part past filesz (.bss) needs no work
+    memory.loadToMainMemory(ph.vaddr, file.data() + ph.offset, ph.filesz);
+
+    // the executable segment holding the entry point is the program memory
+    if ((ph.flags & elf_pf_x) and ph.vaddr <= eh.entry and eh.entry < ph.vaddr + ph.memsz) {
+      program.begin = ph.vaddr & ~3u;
+      program.end = roundUpToWord(ph.vaddr + ph.filesz);
+      found_entry = true;
+    }
+  }
+  if (not found_entry)
+    throw std::runtime_error("ELF entry point is not in an executable segment");
+  return program;
+}
+
+} // namespace
+
+Program loadProgram(Memory &memory, const std::string &path, ProgramFormat format,
+                    const Word load_address) {
+  if (format == ProgramFormat::Text)
+    return loadText(memory, path);
+
+  MappedFile file(path);
+  if (format == ProgramFormat::Auto)
+    format = file.mapped() and isELF(file) ? ProgramFormat::ELF : ProgramFormat::Text;
+
+  switch (format) {
+  case ProgramFormat::Text:
+    return loadText(memory, path);
+  case ProgramFormat::Raw:
+    if (not file.mapped())
+      throw std::runtime_error("raw images must be regular, non-empty files");
+    return loadRaw(memory, file, load_address);
+  case ProgramFormat::ELF:
+    if (not file.mapped() or not isELF(file))
+      throw std::runtime_error("'" + path + "' is not an ELF file");
+    return loadELF(memory, file);
+  default:
+    throw std::runtime_error("unknown program format");
+  }
+}
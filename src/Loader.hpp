@@ -0,0 +1,26 @@
+#ifndef __LOADER_H
+#define __LOADER_H
+
+#include "Memory.hpp"
+#include <string>
+
+enum class ProgramFormat {
+  Auto, // ELF if the file starts with the ELF magic, Text otherwise
+  Text, // one line of 32 '0'/'1' characters per instruction, as asm.py emits
+  Raw,  // little-endian image copied verbatim to the load address
+  ELF   // ELF32 RISC-V executable
+};
+
+// Where a loaded program lives and where execution starts. Simulation ends
+// when the PC reaches end, i.e. falls off the program.
+struct Program {
+  Word entry = 0;
+  Word begin = 0, end = 0;
+};
+
+// Loads the program at path into main memory. Load addresses only apply to
+// Raw images; Text programs always start at 0 and ELF files carry their own.
+Program loadProgram(Memory &, const std::string &path, ProgramFormat format,
+                    const Word load_address = 0);
+
+#endif /* end of __LOADER_H */
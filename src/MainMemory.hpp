@@ -0,0 +1,216 @@
+#ifndef __MAIN_MEMORY_H
+#define __MAIN_MEMORY_H
+
+#include "MemoryLevel.hpp"
+#include "Serialize.hpp"
+#include <algorithm> // for std::all_of, std::min
+#include <array>     // for std::array
+#include <cstring>   // for std::memcpy
+#include <memory>    // for std::unique_ptr
+#include <vector>    // for std::vector
+
+class MainMemory final : public MemoryLevel {
+
+  const Word size;
+  const Cycle access_time;
+
+  // non word-aligned memory accesses are illegal according to documentation
+  // so, for ease of implementation, we use a memory with word-sized elements.
+  // It is split into 4 KiB pages allocated on first write, found through a
+  // two-level page table, so only the touched part of the address space costs
+  // anything; pages never written read as zero.
+  static constexpr Word page_words = 4096 / sizeof(Word);
+  static constexpr Word page_bits = 10;     // log2(page_words)
+  static constexpr Word directory_bits = 10; // pages per directory entry
+  using Page = std::array<Word, page_words>;
+  using PageDirectory = std::array<std::unique_ptr<Page>, 1u << directory_bits>;
+
+  std::vector<std::unique_ptr<PageDirectory>> page_table;
+
+  // last page looked up, accesses tend to stay within a page
+  Word last_page_number = ~0u;
+  Page *last_page = nullptr;
+
+  // idx is a word index; returns nullptr for a never written page unless allocate
+  Page *getPage(const Word idx, const bool allocate) {
+    const Word page_number = idx >> page_bits;
+    if (page_number == last_page_number)
+      return last_page;
+
+    auto &directory = page_table[page_number >> directory_bits];
+    if (not directory) {
+      if (not allocate)
+        return nullptr;
+      directory = std::make_unique<PageDirectory>();
+    }
+    auto &page = (*directory)[page_number & ((1u << directory_bits) - 1)];
+    if (not page) {
+      if (not allocate)
+        return nullptr;
+      page = std::make_unique<Page>();
+      page->fill(0);
+    }
+    last_page_number = page_number;
+    last_page = page.get();
+    return last_page;
+  }
+
+  Word readWord(const Word idx) {
+    Page *page = getPage(idx, false);
+    return page ? (*page)[idx & (page_words - 1)] : 0;
+  }
+
+  void writeWord(const Word idx, const Word val) {
+    (*getPage(idx, true))[idx & (page_words - 1)] = val;
+  }
+
+public:
+  // size is in terms of Word, up to the whole 32-bit address space
+  MainMemory(const Cycle access_time_ = 100, const Word size_ = 256)
+      : size(size_), access_time(access_time_),
+        page_table((static_cast<std::size_t>(1) << (XLEN - 2 - page_bits)) >> directory_bits) {
+    if (size > (1u << (XLEN - 2)))
+      throw std::runtime_error("memory larger than the address space");
+  }
+
+  MainMemory(const MainMemory &) = delete;
+  MainMemory(MainMemory &&) = delete;
+
+  std::pair<Word, Cycle> getData(Word idx) override {
+    idx /= 4;
+    if (idx >= size)
+      throw std::runtime_error("index outside memory bounds");
+    return {readWord(idx), access_time};
+  }
+
+  Cycle writeData(Word idx, const Word val) override {
+    idx /= 4;
+    if (idx >= size)
+      throw std::runtime_error("index outside memory bounds");
+    writeWord(idx, val);
+    return access_time;
+  }
+
+  bool inBounds(const Word idx, const std::size_t words) const override {
+    return idx / 4 + words <= size;
+  }
+
+  Word peekData(Word idx) override {
+    idx /= 4;
+    if (idx >= size)
+      throw std::runtime_error("index outside memory bounds");
+    return readWord(idx);
+  }
+
+  void pokeData(Word idx, const Word val) override {
+    idx /= 4;
+    if (idx >= size)
+      throw std::runtime_error("index outside memory bounds");
+    writeWord(idx, val);
+  }
+
+  Cycle readBlock(Word idx, Span<Word> block) override {
+    idx /= 4;
+    if (idx + block.size() > size)
+      throw std::runtime_error("block outside memory bounds");
+    for (Word i = 0; i < block.size(); ++i)
+      block[i] = readWord(idx + i);
+    return access_time;
+  }
+
+  Cycle writeBlock(Word idx, Span<const Word> block, const bool = true) override {
+    idx /= 4;
+    if (idx + block.size() > size)
+      throw std::runtime_error("block outside memory bounds");
+    for (Word i = 0; i < block.size(); ++i)
+      writeWord(idx + i, block[i]);
+    return access_time;
+  }
+
+  // copies a little-endian byte image to memory, byte addressed as images need
+  // not be word-sized
+  void loadBytes(Word address, const unsigned char *bytes, std::size_t n) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "loading images by memcpy requires a little-endian host"
+#endif
+    if (address + n > static_cast<std::size_t>(size) * 4)
+      throw std::runtime_error("block outside memory bounds");
+    // copy page by page, the last chunk may end mid-page
+    while (n > 0) {
+      const Word in_page = address % (page_words * 4);
+      const std::size_t chunk = std::min<std::size_t>(n, page_words * 4 - in_page);
+      Page *page = getPage(address / 4, true);
+      std::memcpy(reinterpret_cast<unsigned char *>(page->data()) + in_page, bytes, chunk);
+      address += chunk;
+      bytes += chunk;
+      n -= chunk;
+    }
+  }
+
+  // Streams every allocated page to os, as its page number followed by its
+  // contents; pages holding only zeros are written without their contents.
+  void save(std::ostream &os) {
+    writeValue<Word>(os, size);
+    const Word no_of_pages = (size + page_words - 1) / page_words;
+    for (Word p = 0; p < no_of_pages; ++p) {
+      const Page *page = getPage(p * page_words, false);
+      if (page == nullptr)
+        continue;
+      const bool zero = std::all_of(page->begin(), page->end(), [](Word w) { return w == 0; });
+      writeValue<Word>(os, p);
+      writeValue<std::uint8_t>(os, zero);
+      if (not zero)
+        os.write(reinterpret_cast<const char *>(page->data()), sizeof(Page));
+    }
+    // no page has this number
+    writeValue<Word>(os, ~0u);
+  }
+
+  // replaces the contents of memory with pages written by save; the memory
+  // may be of a different size as long as the pages fit
+  void restore(std::istream &is) {
+    readValue<Word>(is);
+    for (auto &directory : page_table)
+      directory.reset();
+    last_page_number = ~0u;
+    last_page = nullptr;
+
+    for (Word p; (p = readValue<Word>(is)) != ~0u;) {
+      if (p >= (size + page_words - 1) / page_words)
+        throw std::runtime_error("checkpoint does not fit in main memory");
+      Page *page = getPage(p * page_words, true);
+      if (readValue<std::uint8_t>(is) == 0 and
+          not is.read(reinterpret_cast<char *>(page->data()), sizeof(Page)))
+        throw std::runtime_error("truncated checkpoint");
+    }
+  }
+
+  void dump(std::ostream &os) {
+    os << "Main Memory\n";
+    os << "===========\n";
+
+    // formatting changes
+    char prev_fill = os.fill('0');
+    os << std::hex;
+
+    // only pages that were ever written are shown
+    const Word no_of_pages = (size + page_words - 1) / page_words;
+    for (Word p = 0; p < no_of_pages; ++p) {
+      Page *page = getPage(p * page_words, false);
+      if (page == nullptr)
+        continue;
+      for (Word i = p * page_words; i < size and i < (p + 1) * page_words; ++i) {
+        if (!(i & 0b11))
+          os << "0x" << std::setw(XLEN / 4) << i * 4 << " : ";
+        os << "0x" << std::setw(XLEN / 4) << (*page)[i & (page_words - 1)];
+        os << ((i & 0b11) == 0b11 ? '\n' : ' ');
+      }
+    }
+
+    // reset formatting changes
+    os << std::dec;
+    os.fill(prev_fill);
+  }
+};
+
+#endif /* end of __MAIN_MEMORY_H */
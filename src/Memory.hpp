@@ -1,303 +1,193 @@
 #ifndef __MEMORY_H
 #define __MEMORY_H
 
-#include "common.hpp"
-#include <list>     // for std::list
-#include <optional> // for std::optional
-#include <random>   // for random number
-#include <vector>   // for std::vector
+#include "AccessTrace.hpp"
+#include "Cache.hpp"
+#include "CodeWrites.hpp"
+#include <vector> // for std::vector
 
-class MainMemory final {
+class Memory final {
 
-  const Word size;
-  const Cycle access_time;
+  MainMemory *mainMemory;
+  // first cache level for instruction fetches and for data accesses, the same
+  // cache if the first level is unified, nullptr without caches
+  Cache *icache = nullptr, *dcache = nullptr;
+  // every cache level, in dump order
+  std::vector<Cache *> caches;
 
-  // non word-aligned memory accesses are illegal according to documentation
-  // so, for ease of implementation, we use a flat memory with word-sized elements
-  std::vector<Word> mem;
+  // stores into program memory, which may change code already decoded
+  CodeWriteTracker code_writes;
 
-  friend class Cache;
+  // if set, every fetch, load and store is appended to it
+  AccessRecorder *recorder = nullptr;
 
-  std::pair<std::vector<Word>, Cycle> getBlock(Word idx, Word num) {
-    idx /= 4;
-    if (idx + num > size)
-      throw std::runtime_error("block outside memory bounds");
-    std::vector<Word> block(mem.begin() + idx, mem.begin() + idx + num);
-    return {block, access_time};
-  }
+  // where warnings go
+  std::ostream *diagnostics = &std::cerr;
 
-  Cycle writeBlock(Word idx, const std::vector<Word> &block) {
-    idx /= 4;
-    if (idx + block.size() > size)
-      throw std::runtime_error("block outside memory bounds");
-    std::copy(block.begin(), block.end(), mem.begin() + idx);
-    return access_time;
-  }
+  // while set, accesses are functional: they take no time, are not recorded
+  // and leave the caches' statistics and replacement state alone
+  bool functional = false;
 
 public:
-  MainMemory(const Cycle access_time_ = 100, const Word size_ = 256)
-      : size(size_), access_time(access_time_), mem(size_) {}
-
-  std::pair<Word, Cycle> getData(Word idx) {
-    idx /= 4;
-    if (idx >= size)
-      throw std::runtime_error("index outside memory bounds");
-    return {mem[idx], access_time};
-  }
+  Memory(MainMemory *mainMemory_) : mainMemory(mainMemory_) {}
 
-  Cycle writeData(Word idx, const Word val) {
-    idx /= 4;
-    if (idx >= size)
-      throw std::runtime_error("index outside memory bounds");
-    mem[idx] = val;
-    return access_time;
+  Memory(MainMemory *mainMemory_, Cache *cache_)
+      : mainMemory(mainMemory_), icache(cache_), dcache(cache_), caches{cache_} {
+    cache_->setMemory(mainMemory);
   }
 
-  void dump(std::ostream &os) {
-    os << "Main Memory\n";
-    os << "===========\n";
+  Memory(MainMemory *mainMemory_, const CacheHierarchy &hierarchy)
+      : mainMemory(mainMemory_), icache(hierarchy.instructionCache()),
+        dcache(hierarchy.dataCache()), caches(hierarchy.levels()) {}
 
-    // formatting changes
-    char prev_fill = os.fill('0');
-    os << std::hex;
+  Memory(const Memory &other) = default;
 
-    for (Word i = 0; i < size; ++i) {
-      if (!(i & 0b11))
-        os << "0x" << std::setw(XLEN / 4) << i * 4 << " : ";
-      os << "0x" << std::setw(XLEN / 4) << mem[i];
-      os << ((i & 0b11) == 0b11 ? '\n' : ' ');
-    }
-
-    // reset formatting changes
-    os << std::dec;
-    os.fill(prev_fill);
-  }
-};
-
-enum class WritePolicy { WriteBack, WriteThrough };
-
-enum class ReplacementPolicy { LRU, RANDOM, FIFO };
+  Memory(Memory &&) = delete;
 
-class Cache final {
-  MainMemory *memory = nullptr;
-  Word hits = 0, misses = 0;
+  void setRecorder(AccessRecorder *recorder_) { recorder = recorder_; }
 
-  const Word size, block_size, associativity;
-  const Cycle miss_penalty, hit_time;
-  const WritePolicy WP;
-  const ReplacementPolicy RP;
+  void setDiagnostics(std::ostream &os) { diagnostics = &os; }
 
-  const Word offset_bits, index_bits, tag_bits;
+  void setFunctional(const bool functional_) { functional = functional_; }
 
-  struct CacheTableEntry {
-    Word index = 0, tag = 0;
-    std::vector<Word> data;
-    bool isActive = false, isDirty = false;
-    CacheTableEntry(Word size_) : data(size_) {}
-  };
+  // starts tracking stores into [begin, end), dropping the hooks of the
+  // previous program
+  void set_program_memory(const Word begin, const Word end) { code_writes.setRange(begin, end); }
 
-  std::vector<CacheTableEntry> table;
+  // hook called with the page of program memory every store into it hits
+  void addCodeWriteHook(CodeWriteTracker::Hook hook) { code_writes.addHook(std::move(hook)); }
 
-  std::vector<std::list<CacheTableEntry *>> setOrder;
+  const CodeWriteTracker &getCodeWrites() const { return code_writes; }
 
-  static Word takeLog(const Word x) {
-    for (Word i = 0; i < XLEN; ++i)
-      if ((1u << i) == x)
-        return i;
-    throw std::runtime_error("not a power of 2");
+  std::pair<Word, Cycle> fetchInstruction(const Word idx) {
+    if (idx & 3)
+      throw std::runtime_error("unaligned memory access");
+    if (functional)
+      return {icache ? icache->peekData(idx) : mainMemory->peekData(idx), 0};
+    // a unified cache must not mistake fetches for the last load's
+    if (icache)
+      icache->setPC(no_PC);
+    auto result = icache ? icache->getData(idx) : mainMemory->getData(idx);
+    if (recorder)
+      recorder->record(AccessKind::Fetch, idx, 0, result.second);
+    return result;
   }
 
-  Word getOffset(Word address) { return address & ((1u << offset_bits) - 1); }
-
-  Word getIndex(Word address) { return (address >> offset_bits) & ((1u << index_bits) - 1); }
-
-  Word getTag(Word address) { return address >> (index_bits + offset_bits); }
-
-  Word getAddress(const Word tag, const Word index, const Word offset) {
-    Word address = 0;
-    address |= tag;
-    address <<= index_bits;
-    address |= index;
-    address <<= offset_bits;
-    address |= offset;
-    return address;
+  // the word a fetch would return, without timing or any side effects
+  Word peekInstruction(const Word idx) {
+    return icache ? icache->peekData(idx) : mainMemory->peekData(idx);
   }
 
-  CacheTableEntry *getReplacementBlock(const Word index) {
-    static std::mt19937_64 rng(std::random_device{}());
-    switch (RP) {
-    case ReplacementPolicy::RANDOM: {
-      Word choice = std::uniform_int_distribution<int>(0, associativity - 1)(rng);
-      return &table[index * associativity + choice];
-    }
-    case ReplacementPolicy::LRU:
-    case ReplacementPolicy::FIFO: {
-      auto victim = setOrder[index].front();
-      setOrder[index].pop_front();
-      setOrder[index].push_back(victim);
-      return victim;
-    }
-    default:
-      throw std::runtime_error("wtaf");
-    }
+  // PC is that of the load, for prefetchers that track instructions
+  std::pair<Word, Cycle> getData(const Word idx, const Word PC = no_PC) {
+    if (idx & 3)
+      throw std::runtime_error("unaligned memory access");
+    if (functional)
+      return {dcache ? dcache->peekData(idx) : mainMemory->peekData(idx), 0};
+    if (dcache)
+      dcache->setPC(PC);
+    auto result = dcache ? dcache->getData(idx) : mainMemory->getData(idx);
+    if (recorder)
+      recorder->record(AccessKind::Load, idx, 0, result.second);
+    return result;
   }
 
-  std::pair<CacheTableEntry *, Cycle> getTableEntry(const Word address) {
-    const Word index = getIndex(address), tag = getTag(address);
-    for (Word idx = 0; idx < associativity; ++idx) {
-      auto tableEntry = &table[index * associativity + idx];
-      if (tableEntry->isActive and tableEntry->tag == tag) {
-        if (tableEntry->index != index)
-          throw std::runtime_error("cache in inconsistent state");
-        ++hits;
-        if (RP == ReplacementPolicy::LRU) {
-          setOrder[index].remove(tableEntry);
-          setOrder[index].push_back(tableEntry);
-        }
-        return {tableEntry, hit_time};
-      }
+  Cycle writeData(const Word idx, const Word val, const Word PC = no_PC) {
+    if (idx & 3)
+      throw std::runtime_error("unaligned memory access");
+    Cycle t = 0;
+    if (functional) {
+      dcache ? dcache->pokeData(idx, val) : mainMemory->pokeData(idx, val);
+    } else {
+      if (dcache)
+        dcache->setPC(PC);
+      t = dcache ? dcache->writeData(idx, val) : mainMemory->writeData(idx, val);
+      if (recorder)
+        recorder->record(AccessKind::Store, idx, val, t);
     }
-    ++misses;
-    auto [block, t_mem] = memory->getBlock(getAddress(tag, index, 0), block_size);
-    auto tableEntry = getReplacementBlock(index);
-    // if victim is dirty, write it to memory
-    if (tableEntry->isDirty)
-      t_mem += memory->writeBlock(getAddress(tableEntry->tag, tableEntry->index, 0), tableEntry->data);
-    // replace victim with new entry
-    tableEntry->index = index;
-    tableEntry->tag = tag;
-    std::copy(block.begin(), block.end(), tableEntry->data.begin());
-    tableEntry->isActive = true;
-    tableEntry->isDirty = false;
-    return {tableEntry, hit_time + miss_penalty + t_mem};
-  }
-
-public:
-  // size, block_size are in terms of Word
-  Cache(Word size_ = 32, Cycle miss_penalty_ = 4, Cycle hit_time_ = 10,
-        Word block_size_ = 2, Word associativity_ = 2,
-        WritePolicy WP_ = WritePolicy::WriteThrough,
-        ReplacementPolicy RP_ = ReplacementPolicy::LRU)
-      : size(size_), block_size(block_size_), associativity(associativity_),
-        miss_penalty(miss_penalty_), hit_time(hit_time_), WP(WP_), RP(RP_),
-        offset_bits(takeLog(block_size * (XLEN / 8))),
-        index_bits(takeLog(size / block_size / associativity)),
-        tag_bits(XLEN - offset_bits - index_bits),
-        table(size / block_size, {block_size}),
-        setOrder(size / block_size / associativity) {
-    Word no_of_sets = 1u << index_bits;
-    for (Word i = 0; i < no_of_sets; ++i)
-      for (Word j = 0; j < associativity; ++j)
-        setOrder[i].push_back(&table[i * associativity + j]);
-  }
-
-  Cache(Cache &) = delete;
-  Cache(Cache &&) = delete;
-
-  void setMemory(MainMemory *memory_) { memory = memory_; }
-
-  std::pair<Word, Cycle> getData(const Word idx) {
-    auto [tableEntry, t] = getTableEntry(idx);
-    Word i = getOffset(idx) / 4;
-    return {tableEntry->data[i], t};
-  }
-
-  Cycle writeData(const Word idx, const Word val) {
-    auto [tableEntry, t] = getTableEntry(idx);
-    Word i = getOffset(idx) / 4;
-    tableEntry->data[i] = val;
-    if (WP == WritePolicy::WriteThrough)
-      t += memory->writeData(idx, val);
-    else
-      tableEntry->isDirty = true;
+    // hooks run after the store so that they see the new code
+    if (code_writes.covers(idx))
+      code_writes.record(idx);
     return t;
   }
 
-  void dump(std::ostream &os) {
-    os << "Cache\n";
-    os << "=====\n";
-
-    os << "Hits: " << hits << "\tMisses: " << misses << "\n";
-    os << "Miss Rate: " << 100 * static_cast<long double>(misses) / (hits + misses) << "%\n";
-
-    // formatting changes
-    char prev_fill = os.fill('0');
-    os << std::hex;
-
-    for (CacheTableEntry &tableEntry : table) {
-      if (not tableEntry.isActive)
-        continue;
-      os << "0x" << std::setw(XLEN / 4)
-         << getAddress(tableEntry.tag, tableEntry.index, 0) << " : ";
-      for (auto i : tableEntry.data)
-        os << "0x" << std::setw(XLEN / 4) << i << " ";
-      os << "\n";
+  // stores the bytes of val selected by mask into the word at idx
+  Cycle writeMasked(const Word idx, const Word val, const Word mask, const Word PC = no_PC) {
+    if (idx & 3)
+      throw std::runtime_error("unaligned memory access");
+    MemoryLevel *level = dcache ? static_cast<MemoryLevel *>(dcache) : mainMemory;
+    Cycle t = 0;
+    if (functional) {
+      level->pokeData(idx, (level->peekData(idx) & ~mask) | (val & mask));
+    } else {
+      if (dcache)
+        dcache->setPC(PC);
+      t = level->writeMasked(idx, val, mask);
+      // traces hold whole words, so that replaying them needs no merging
+      if (recorder)
+        recorder->record(AccessKind::Store, idx, level->peekData(idx), t);
     }
-
-    // reset formatting changes
-    os << std::dec;
-    os.fill(prev_fill);
+    if (code_writes.covers(idx))
+      code_writes.record(idx);
+    return t;
   }
-};
 
-class Memory final {
-
-  MainMemory *mainMemory;
-  std::optional<Cache *> cache;
-
-  // used for warning on writes to program memory
-  Word program_begin, program_end;
-
-public:
-  Memory(MainMemory *mainMemory_) : mainMemory(mainMemory_) {}
-
-  Memory(MainMemory *mainMemory_, Cache *cache_)
-      : mainMemory(mainMemory_), cache(cache_) {
-    if (cache)
-      cache.value()->setMemory(mainMemory);
+  // UNSAFE fn to write to main memory directly, cache MUST NOT be used before
+  // this should be used ONLY to initialize program in memory at beginning
+  Cycle writeDataToMainMemory(const Word idx, const Word val) {
+    return mainMemory->writeData(idx, val);
   }
 
-  Memory(const Memory &other)
-      : mainMemory(other.mainMemory), cache(other.cache),
-        program_begin(other.program_begin), program_end(other.program_end) {
-    if (cache)
-      cache.value()->setMemory(mainMemory);
+  // UNSAFE fn to copy a whole image to main memory, same restrictions as above
+  void loadToMainMemory(const Word address, const unsigned char *bytes, const std::size_t n) {
+    mainMemory->loadBytes(address, bytes, n);
   }
 
-  Memory(Memory &&) = delete;
+  // UNSAFE fn to read main memory directly, bypassing the cache and its timing
+  // the value may be stale if the cache holds a dirty copy of the word
+  Word readDataFromMainMemory(const Word idx) { return mainMemory->getData(idx).first; }
 
-  void set_program_memory(const Word begin, const Word end) {
-    program_begin = begin;
-    program_end = end;
-  }
-
-  std::pair<Word, Cycle> getData(const Word idx) {
-    if (idx & 3)
-      throw std::runtime_error("unaligned memory access");
-    if (cache)
-      return cache.value()->getData(idx);
-    return mainMemory->getData(idx);
+  // Writes main memory and the state of every cache level to os.
+  void save(std::ostream &os) {
+    mainMemory->save(os);
+    writeValue<std::uint32_t>(os, caches.size());
+    for (Cache *cache : caches) {
+      // levels are length-prefixed so that ones that cannot be restored are
+      // skipped
+      std::ostringstream level;
+      cache->save(level);
+      writeString(os, level.str());
+    }
   }
 
-  Cycle writeData(const Word idx, const Word val) {
-    if (idx & 3)
-      throw std::runtime_error("unaligned memory access");
-    if (program_begin <= idx and idx < program_end)
-      std::cerr << "WARNING: write to program memory, may make program ill-formed\n";
-    if (cache)
-      return cache.value()->writeData(idx, val);
-    return mainMemory->writeData(idx, val);
+  // Restores what save wrote. Cache levels are matched up by position, a
+  // level whose geometry or policies differ from the saved one starts cold.
+  void restore(std::istream &is) {
+    mainMemory->restore(is);
+    const std::uint32_t levels = readValue<std::uint32_t>(is);
+    for (std::uint32_t i = 0; i < levels; ++i) {
+      std::istringstream level(readString(is));
+      if (i < caches.size() and not caches[i]->restore(level))
+        *diagnostics << "WARNING: " << caches[i]->getName()
+                     << " differs from the checkpoint, it starts cold\n";
+    }
+    for (std::size_t i = levels; i < caches.size(); ++i)
+      *diagnostics << "WARNING: " << caches[i]->getName()
+                   << " is not in the checkpoint, it starts cold\n";
   }
 
-  // UNSAFE fn to write to main memory directly, cache MUST NOT be used before
-  // this should be used ONLY to initialize program in memory at beginning
-  Cycle writeDataToMainMemory(const Word idx, const Word val) {
-    return mainMemory->writeData(idx, val);
+  // misses of every cache level so far
+  std::uint64_t misses() const {
+    std::uint64_t total = 0;
+    for (const Cache *cache : caches)
+      total += cache->getStats().misses;
+    return total;
   }
 
   void dump(std::ostream &os) {
-    if (cache) {
-      cache.value()->dump(os);
+    code_writes.dump(os);
+    for (Cache *cache : caches) {
+      cache->dump(os);
       os << "\n";
     }
     mainMemory->dump(os);
@@ -0,0 +1,41 @@
+#ifndef __MEMORY_LEVEL_H
+#define __MEMORY_LEVEL_H
+
+#include "common.hpp"
+
+// A level of the memory hierarchy as seen by the level above it. Addresses
+// are byte addresses, blocks are word-aligned runs of words, and every
+// operation returns the cycles it took.
+class MemoryLevel {
+public:
+  virtual ~MemoryLevel() = default;
+
+  virtual std::pair<Word, Cycle> getData(const Word idx) = 0;
+
+  virtual Cycle writeData(const Word idx, const Word val) = 0;
+
+  // stores the bytes of val selected by mask into the word at idx, for byte
+  // and halfword stores; it costs what a store of the whole word does
+  virtual Cycle writeMasked(const Word idx, const Word val, const Word mask) {
+    return writeData(idx, (peekData(idx) & ~mask) | (val & mask));
+  }
+
+  // fills block with the words starting at idx
+  virtual Cycle readBlock(const Word idx, Span<Word> block) = 0;
+
+  // stores block at idx; dirty tells a cache receiving an evicted line whether
+  // the data differs from the levels below it
+  virtual Cycle writeBlock(const Word idx, Span<const Word> block, const bool dirty = true) = 0;
+
+  // whether the given number of words at idx exist, for speculative accesses such as
+  // prefetches that must not fault
+  virtual bool inBounds(const Word idx, const std::size_t words) const = 0;
+
+  // Functional accesses, for fast-forwarding: they take no time and leave
+  // statistics and replacement state alone. peekData returns the current value
+  // of the word, pokeData updates every copy of it down to main memory.
+  virtual Word peekData(const Word idx) = 0;
+  virtual void pokeData(const Word idx, const Word val) = 0;
+};
+
+#endif /* end of __MEMORY_LEVEL_H */
@@ -0,0 +1,185 @@
+#include "MultiHart.hpp"
+#include <algorithm>          // for std::sort
+#include <condition_variable> // for starting and joining rounds
+#include <mutex>              // for std::mutex
+#include <thread>             // for std::thread
+
+MultiHart::MultiHart(MainMemory *mainMemory_, const std::string binary_path_,
+                     const SimulationConfig &config, const MultiHartConfig &harts_config)
+    : mainMemory(mainMemory_), bus(mainMemory_, harts_config.bus_time),
+      threads(std::min(harts_config.harts,
+                       harts_config.threads
+                           ? harts_config.threads
+                           : std::max(1u, std::thread::hardware_concurrency()))),
+      quantum(harts_config.quantum), binary_path(binary_path_), trace_level(config.trace_level),
+      output(*config.output),
+      times(harts_config.harts, 0), waiting(harts_config.harts, false),
+      errors(harts_config.harts) {
+  if (harts_config.harts == 0 or harts_config.quantum == 0)
+    throw std::runtime_error("there must be at least one hart and a non-zero quantum");
+
+  // harts print nothing themselves, their traces would interleave
+  SimulationConfig hart_config = config;
+  hart_config.trace_level = TraceLevel::None;
+  hart_config.trace_path.clear();
+
+  for (unsigned i = 0; i < harts_config.harts; ++i) {
+    caches.push_back(std::make_unique<CoherentCache>(harts_config.cache, &bus));
+    caches.back()->setName("Hart " + std::to_string(i) + " Cache");
+    harts.push_back(std::make_unique<Simulation>(Memory{mainMemory, caches.back().get()},
+                                                 binary_path, hart_config));
+  }
+}
+
+bool MultiHart::needsBus(const unsigned hart) {
+  Simulation &sim = *harts[hart];
+  const CoherentCache &cache = *caches[hart];
+  const Word PC = sim.getPC();
+  if (not cache.holds(PC, false))
+    return true;
+  const DecodedInstruction d = decode(*cache.peek(PC));
+  if (isLoad(d.op))
+    return not cache.holds(sim.registers().getReg(d.rs1) + d.imm, false);
+  if (isStore(d.op))
+    return not cache.holds(sim.registers().getReg(d.rs1) + d.imm, true);
+  return false;
+}
+
+void MultiHart::runLocally(const unsigned hart, const Cycle limit) {
+  Simulation &sim = *harts[hart];
+  try {
+    while (times[hart] < limit and not sim.finished()) {
+      if (needsBus(hart)) {
+        waiting[hart] = true;
+        break;
+      }
+      times[hart] += sim.step();
+    }
+  } catch (std::exception &e) {
+    errors[hart] = e.what();
+  }
+}
+
+void MultiHart::runWaiting() {
+  std::vector<unsigned> order;
+  for (unsigned i = 0; i < harts.size(); ++i)
+    if (waiting[i])
+      order.push_back(i);
+  std::sort(order.begin(), order.end(), [&](unsigned a, unsigned b) {
+    return std::tie(times[a], a) < std::tie(times[b], b);
+  });
+
+  bus.setOpen(true);
+  for (const unsigned hart : order) {
+    waiting[hart] = false;
+    try {
+      times[hart] += harts[hart]->step();
+    } catch (std::exception &e) {
+      errors[hart] = e.what();
+    }
+  }
+  bus.setOpen(false);
+}
+
+void MultiHart::checkErrors() const {
+  for (unsigned i = 0; i < errors.size(); ++i)
+    if (not errors[i].empty())
+      throw std::runtime_error("hart " + std::to_string(i) + ": " + errors[i]);
+}
+
+Cycle MultiHart::simulate() {
+  // the program is loaded once, every hart starts from the same image
+  const Program program = harts[0]->start();
+  for (unsigned i = 0; i < harts.size(); ++i) {
+    if (i != 0)
+      harts[i]->start(program);
+    harts[i]->registers().writeReg(10, i);
+  }
+
+  // worker w runs harts w, w + threads, ... in the parallel part of a round
+  Cycle limit = 0;
+  auto runShare = [&](const unsigned worker) {
+    for (unsigned i = worker; i < harts.size(); i += threads)
+      runLocally(i, limit);
+  };
+
+  std::mutex mutex;
+  std::condition_variable wakeup;
+  std::uint64_t round = 0;
+  unsigned busy = 0;
+  bool done = false;
+
+  std::vector<std::thread> pool;
+  for (unsigned w = 1; w < threads; ++w)
+    pool.emplace_back([&, w]() {
+      for (std::uint64_t seen = 0;;) {
+        {
+          std::unique_lock<std::mutex> lock(mutex);
+          wakeup.wait(lock, [&]() { return done or round != seen; });
+          if (done)
+            return;
+          seen = round;
+        }
+        runShare(w);
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--busy == 0)
+          wakeup.notify_all();
+      }
+    });
+  auto stopPool = [&]() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      done = true;
+    }
+    wakeup.notify_all();
+    for (auto &thread : pool)
+      thread.join();
+  };
+
+  // the cycles of the slowest hart still running, if any
+  auto slowest = [&]() {
+    std::optional<Cycle> result;
+    for (unsigned i = 0; i < harts.size(); ++i)
+      if (not harts[i]->finished())
+        result = std::min(result.value_or(times[i]), times[i]);
+    return result;
+  };
+  try {
+    for (std::optional<Cycle> base; (base = slowest());) {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        limit = *base + quantum;
+        ++round;
+        busy = threads - 1;
+      }
+      wakeup.notify_all();
+      runShare(0);
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        wakeup.wait(lock, [&]() { return busy == 0; });
+      }
+      checkErrors();
+      runWaiting();
+      checkErrors();
+    }
+  } catch (...) {
+    stopPool();
+    throw;
+  }
+  stopPool();
+
+  const Cycle total = *std::max_element(times.begin(), times.end());
+  if (trace_level >= TraceLevel::Summary) {
+    for (unsigned i = 0; i < harts.size(); ++i)
+      output << "Hart " << i << " cycles : " << times[i] << "\n";
+    output << "Total simulation cycles : " << total << "\n\n";
+    for (auto &cache : caches) {
+      cache->dump(output);
+      output << "\n";
+    }
+    bus.dump(output);
+    output << "\n";
+    mainMemory->dump(output);
+  }
+  return total;
+}
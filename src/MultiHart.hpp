@@ -0,0 +1,76 @@
+#ifndef __MULTI_HART_H
+#define __MULTI_HART_H
+
+#include "Coherence.hpp"
+#include "Simulation.hpp"
+#include <cstdint> // for std::uint8_t, std::uint64_t
+#include <memory>  // for std::unique_ptr
+#include <string>
+#include <vector>  // for std::vector
+
+struct MultiHartConfig {
+  unsigned harts = 2;
+  // host threads running harts, 0 for one per hardware thread
+  unsigned threads = 0;
+  // cycles harts may run apart from each other between synchronizations
+  Cycle quantum = 1000;
+  // private cache of every hart, always write-back
+  CacheConfig cache;
+  // cycles each bus transaction holds the bus for
+  Cycle bus_time = 4;
+};
+
+// Runs the program on several harts, each with its own registers, PC and
+// private cache, sharing one main memory through a MESI snooping bus. Hart i
+// starts at the entry point with i in a0 (r10).
+//
+// Execution proceeds in rounds. First every hart runs on its own host thread
+// until its next instruction needs a bus transaction, it is a quantum of
+// cycles ahead of the slowest hart at the start of the round or it finishes;
+// as such instructions only touch lines the
+// hart's cache holds in a suitable state, harts cannot observe each other
+// and the order the host threads run in does not matter. Then the harts
+// waiting for the bus each execute that one instruction, ordered by their
+// cycle count (ties by hart id), with the bus open. Results therefore depend
+// only on the program and configuration, not on the number of host threads.
+class MultiHart final {
+
+  MainMemory *mainMemory;
+  Bus bus;
+  std::vector<std::unique_ptr<CoherentCache>> caches;
+  std::vector<std::unique_ptr<Simulation>> harts;
+
+  const unsigned threads;
+  const Cycle quantum;
+  const std::string binary_path;
+  const TraceLevel trace_level;
+  std::ostream &output;
+
+  // cycles each hart has run for
+  std::vector<Cycle> times;
+  // set during a round for harts stopped at an instruction needing the bus
+  std::vector<std::uint8_t> waiting;
+  // set for harts whose instruction failed, with the reason
+  std::vector<std::string> errors;
+
+  // whether the next instruction of hart needs a bus transaction
+  bool needsBus(const unsigned hart);
+
+  // the parallel part of a round for one hart, running until limit cycles
+  void runLocally(const unsigned hart, const Cycle limit);
+
+  // the serial part of a round
+  void runWaiting();
+
+  void checkErrors() const;
+
+public:
+  MultiHart(MainMemory *mainMemory_, const std::string binary_path_,
+            const SimulationConfig &config, const MultiHartConfig &harts_config);
+
+  // runs every hart to the end of the program, returning the cycles of the
+  // slowest one
+  Cycle simulate();
+};
+
+#endif /* end of __MULTI_HART_H */
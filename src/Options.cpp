@@ -0,0 +1,196 @@
+#include "Options.hpp"
+
+void parseArgument(const std::string &arg, Options &options) {
+  auto harts = [&]() -> MultiHartConfig & {
+    if (not options.multi_hart)
+      options.multi_hart.emplace();
+    return *options.multi_hart;
+  };
+
+  if (arg == "--engine=interpreter") {
+    options.config.engine = Engine::Interpreter;
+  } else if (arg == "--engine=block") {
+    options.config.engine = Engine::BasicBlock;
+  } else if (arg == "--trace=none") {
+    options.config.trace_level = TraceLevel::None;
+  } else if (arg == "--trace=summary") {
+    options.config.trace_level = TraceLevel::Summary;
+  } else if (arg == "--trace=pc") {
+    options.config.trace_level = TraceLevel::PC;
+  } else if (arg == "--trace=full") {
+    options.config.trace_level = TraceLevel::Full;
+  } else if (arg == "--timing=serial") {
+    options.config.timing = Timing::Serial;
+  } else if (arg == "--timing=pipeline") {
+    options.config.timing = Timing::Pipeline;
+  } else if (arg == "--timing=event") {
+    options.config.timing = Timing::Event;
+  } else if (arg.rfind("--event-core=", 0) == 0) {
+    options.config.timing = Timing::Event;
+    options.config.event_core = parseEventCoreConfig(
+        arg.substr(std::string("--event-core=").size()), options.config.event_core);
+  } else if (arg.rfind("--pipeline=", 0) == 0) {
+    // the event core shares the branch settings
+    if (options.config.timing != Timing::Event)
+      options.config.timing = Timing::Pipeline;
+    options.config.pipeline = parsePipelineConfig(arg.substr(std::string("--pipeline=").size()),
+                                                  options.config.pipeline);
+  } else if (arg.rfind("--predictor=", 0) == 0) {
+    if (options.config.timing != Timing::Event)
+      options.config.timing = Timing::Pipeline;
+    options.config.pipeline.predictor =
+        parsePredictorConfig(arg.substr(std::string("--predictor=").size()));
+  } else if (arg == "--profile") {
+    options.config.profile = true;
+  } else if (arg.rfind("--profile-csv=", 0) == 0) {
+    options.config.profile = true;
+    options.profile_csv_path = arg.substr(std::string("--profile-csv=").size());
+  } else if (arg.rfind("--profile-folded=", 0) == 0) {
+    options.config.profile = true;
+    options.profile_folded_path = arg.substr(std::string("--profile-folded=").size());
+  } else if (arg.rfind("--symbols=", 0) == 0) {
+    options.config.symbols_path = arg.substr(std::string("--symbols=").size());
+  } else if (arg.rfind("--trace-file=", 0) == 0) {
+    options.config.trace_path = arg.substr(std::string("--trace-file=").size());
+  } else if (arg.rfind("--access-trace=", 0) == 0) {
+    options.access_trace_path = arg.substr(std::string("--access-trace=").size());
+  } else if (arg.rfind("--replay=", 0) == 0) {
+    options.replay_path = arg.substr(std::string("--replay=").size());
+  } else if (arg == "--format=auto") {
+    options.config.format = ProgramFormat::Auto;
+  } else if (arg == "--format=text") {
+    options.config.format = ProgramFormat::Text;
+  } else if (arg == "--format=raw") {
+    options.config.format = ProgramFormat::Raw;
+  } else if (arg == "--format=elf") {
+    options.config.format = ProgramFormat::ELF;
+  } else if (arg.rfind("--load-address=", 0) == 0) {
+    options.config.load_address =
+        std::stoul(arg.substr(std::string("--load-address=").size()), nullptr, 0);
+  } else if (arg.rfind("--memory-size=", 0) == 0) {
+    const unsigned long long bytes =
+        std::stoull(arg.substr(std::string("--memory-size=").size()), nullptr, 0);
+    if (bytes == 0 or bytes % 4 or bytes > (1ull << XLEN))
+      throw std::runtime_error("memory size must be a non-zero multiple of 4 up to 4 GiB");
+    options.memory_size = bytes / 4;
+  } else if (arg.rfind("--cache=", 0) == 0) {
+    options.l1 = parseCacheConfig(arg.substr(std::string("--cache=").size()));
+  } else if (arg.rfind("--l1i=", 0) == 0) {
+    options.hierarchy.l1i = parseCacheConfig(arg.substr(std::string("--l1i=").size()));
+  } else if (arg.rfind("--l1d=", 0) == 0) {
+    options.hierarchy.l1d = parseCacheConfig(arg.substr(std::string("--l1d=").size()));
+  } else if (arg.rfind("--l2=", 0) == 0) {
+    options.l2 = parseCacheConfig(arg.substr(std::string("--l2=").size()));
+  } else if (arg.rfind("--l3=", 0) == 0) {
+    options.l3 = parseCacheConfig(arg.substr(std::string("--l3=").size()));
+  } else if (arg == "--no-cache") {
+    options.no_cache = true;
+  } else if (arg == "--inclusion=nine") {
+    options.hierarchy.inclusion = Inclusion::NINE;
+  } else if (arg == "--inclusion=inclusive") {
+    options.hierarchy.inclusion = Inclusion::Inclusive;
+  } else if (arg == "--inclusion=exclusive") {
+    options.hierarchy.inclusion = Inclusion::Exclusive;
+  } else if (arg.rfind("--sweep=", 0) == 0) {
+    options.sweep_grid = arg.substr(std::string("--sweep=").size());
+  } else if (arg.rfind("--sweep-threads=", 0) == 0) {
+    options.sweep_threads = std::stoul(arg.substr(std::string("--sweep-threads=").size()));
+  } else if (arg == "--miss-curve") {
+    options.miss_curve_grid = "";
+  } else if (arg.rfind("--miss-curve=", 0) == 0) {
+    options.miss_curve_grid = arg.substr(std::string("--miss-curve=").size());
+  } else if (arg.rfind("--harts=", 0) == 0) {
+    harts().harts = std::stoul(arg.substr(std::string("--harts=").size()));
+  } else if (arg.rfind("--hart-threads=", 0) == 0) {
+    harts().threads = std::stoul(arg.substr(std::string("--hart-threads=").size()));
+  } else if (arg.rfind("--quantum=", 0) == 0) {
+    harts().quantum = std::stoull(arg.substr(std::string("--quantum=").size()));
+  } else if (arg.rfind("--bus-time=", 0) == 0) {
+    harts().bus_time = std::stoull(arg.substr(std::string("--bus-time=").size()));
+  } else if (arg == "--sample") {
+    options.sampling.emplace();
+  } else if (arg.rfind("--sample=", 0) == 0) {
+    options.sampling = parseSamplingConfig(arg.substr(std::string("--sample=").size()));
+  } else if (arg.rfind("--checkpoint=", 0) == 0) {
+    options.checkpoint_path = arg.substr(std::string("--checkpoint=").size());
+  } else if (arg.rfind("--checkpoint-after=", 0) == 0) {
+    options.checkpoint_after = std::stoull(arg.substr(std::string("--checkpoint-after=").size()));
+  } else if (arg.rfind("--restore=", 0) == 0) {
+    options.restore_path = arg.substr(std::string("--restore=").size());
+  } else if (arg.rfind("--batch=", 0) == 0) {
+    options.batch_path = arg.substr(std::string("--batch=").size());
+  } else if (arg.rfind("--batch-threads=", 0) == 0) {
+    options.batch_threads = std::stoul(arg.substr(std::string("--batch-threads=").size()));
+  } else if (arg.rfind("--report=", 0) == 0) {
+    options.report_path = arg.substr(std::string("--report=").size());
+  } else if (arg.rfind("--", 0) == 0 or not options.binary_path.empty()) {
+    throw std::invalid_argument("unexpected argument '" + arg + "'");
+  } else {
+    options.binary_path = arg;
+  }
+
+}
+
+void finishOptions(Options &options) {
+  HierarchyConfig &hierarchy = options.hierarchy;
+  if (not options.checkpoint_path.empty() and not options.restore_path.empty())
+    throw std::runtime_error("a run either writes or restores a checkpoint");
+  if (bool(hierarchy.l1i) != bool(hierarchy.l1d) or (options.l1 and hierarchy.l1i))
+    throw std::runtime_error("the first level is either --cache or both --l1i and --l1d");
+
+  if (options.multi_hart) {
+    if (hierarchy.l1i or options.l2 or options.l3 or options.no_cache or
+        not options.sweep_grid.empty() or options.miss_curve_grid or
+        options.config.engine != Engine::Interpreter or not options.config.trace_path.empty() or
+        options.config.timing != Timing::Serial or options.config.profile or
+        not options.checkpoint_path.empty() or not options.restore_path.empty() or
+        options.sampling or not options.access_trace_path.empty() or
+        not options.replay_path.empty())
+      throw std::runtime_error("multiple harts only support a private --cache per hart, the "
+                               "interpreter and serial timing, without profiling");
+    options.multi_hart->cache = options.l1.value_or(CacheConfig{});
+    const CacheConfig &cache = options.multi_hart->cache;
+    if (cache.prefetch.kind != PrefetcherKind::None)
+      throw std::runtime_error("coherent caches do not prefetch");
+    if (cache.mshrs or cache.write_buffer or cache.victim_lines)
+      throw std::runtime_error("coherent caches are blocking and have no write or victim buffers");
+    // per-instruction traces of several harts are not printed
+    options.config.trace_level = std::min(options.config.trace_level, TraceLevel::Summary);
+    return;
+  }
+
+  if (not options.replay_path.empty() and
+      (not options.binary_path.empty() or not options.restore_path.empty() or
+       not options.checkpoint_path.empty() or not options.sweep_grid.empty() or
+       options.miss_curve_grid or options.sampling or not options.access_trace_path.empty() or
+       not options.config.trace_path.empty() or options.config.timing != Timing::Serial or
+       options.config.profile))
+    throw std::runtime_error("a replay only feeds the access trace to the memory subsystem");
+  if (not options.access_trace_path.empty() and
+      (not options.sweep_grid.empty() or options.miss_curve_grid))
+    throw std::runtime_error("a run either writes an access trace or sweeps caches");
+  // the trace records the cycles spent outside the memory subsystem, which
+  // only the serial model keeps apart from memory latencies
+  if (not options.access_trace_path.empty() and options.config.timing != Timing::Serial)
+    throw std::runtime_error("an access trace records runs under serial timing only");
+  // sweep totals are the run's cycles without its memory cycles plus those of
+  // each replayed cache, which only holds for a single cache timed serially
+  if (not options.sweep_grid.empty() and
+      (options.config.timing != Timing::Serial or hierarchy.l1i or options.l2 or options.l3))
+    throw std::runtime_error("a sweep replays the run against a single cache under serial timing");
+
+  if (options.sampling) {
+    if (not options.sweep_grid.empty() or options.miss_curve_grid or
+        not options.checkpoint_path.empty() or not options.access_trace_path.empty())
+      throw std::runtime_error("sampled runs cannot record accesses or write checkpoints");
+    // only the timed windows would be traced
+    options.config.trace_level = std::min(options.config.trace_level, TraceLevel::Summary);
+  }
+
+  hierarchy.unified.clear();
+  if (not hierarchy.l1i)
+    hierarchy.unified.push_back(options.l1.value_or(CacheConfig{}));
+  for (auto &level : {options.l2, options.l3})
+    if (level)
+      hierarchy.unified.push_back(*level);
+}
@@ -0,0 +1,58 @@
+#ifndef __OPTIONS_H
+#define __OPTIONS_H
+
+#include "AccessTraceFile.hpp"
+#include "MultiHart.hpp"
+#include "Simulation.hpp"
+#include <optional> // for std::optional
+#include <string>
+#include <vector>   // for std::vector
+
+// Everything the command line configures, see usage() in Driver.cpp.
+struct Options {
+  std::string binary_path;
+  SimulationConfig config;
+  // in terms of Word, as MainMemory expects
+  Word memory_size = 256;
+  // levels are only collected by parseArgument, finishOptions builds the
+  // hierarchy out of them
+  HierarchyConfig hierarchy;
+  std::optional<CacheConfig> l1, l2, l3;
+  bool no_cache = false;
+
+  std::string sweep_grid;
+  unsigned sweep_threads = 0;
+  std::optional<std::string> miss_curve_grid;
+
+  std::optional<MultiHartConfig> multi_hart;
+
+  // every access of the run is written to the access trace; a replay feeds
+  // one to the caches instead of running a program
+  std::string access_trace_path, replay_path;
+
+  std::optional<SamplingConfig> sampling;
+
+  // profile exports, written after the run
+  std::string profile_csv_path, profile_folded_path;
+
+  // checkpoint written once checkpoint_after cycles have run, ending the run
+  std::string checkpoint_path;
+  Cycle checkpoint_after = 0;
+  // checkpoint the run resumes from, the program is then optional
+  std::string restore_path;
+
+  // manifest of a batch run, and where its report goes (standard output if
+  // empty)
+  std::string batch_path, report_path;
+  unsigned batch_threads = 0;
+};
+
+// Applies one command line argument, an option or the binary path. Throws
+// std::invalid_argument for arguments that are not understood and
+// std::runtime_error for invalid values.
+void parseArgument(const std::string &arg, Options &options);
+
+// Checks that the options fit together and builds the cache hierarchy.
+void finishOptions(Options &options);
+
+#endif /* end of __OPTIONS_H */
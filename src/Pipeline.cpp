@@ -0,0 +1,138 @@
+#include "Pipeline.hpp"
+#include "Serialize.hpp"
+#include "Sweep.hpp" // for parseGridAxes
+#include <algorithm> // for std::max
+
+PipelineConfig parsePipelineConfig(const std::string &spec, PipelineConfig config) {
+  for (const auto &[key, values] : parseGridAxes(spec)) {
+    if (key == "forward") {
+      config.forward_ex = config.forward_mem = false;
+      for (const std::string &value : values) {
+        if (value == "ex")
+          config.forward_ex = true;
+        else if (value == "mem")
+          config.forward_mem = true;
+        else if (value != "none")
+          throw std::runtime_error("unknown forwarding path '" + value + "'");
+      }
+    } else if (key == "flush" and values.size() == 1) {
+      config.flush = std::stoull(values[0]);
+      if (config.flush == 0)
+        throw std::runtime_error("a taken branch flushes at least one cycle");
+    } else {
+      throw std::runtime_error("unknown pipeline setting '" + key + "'");
+    }
+  }
+  return config;
+}
+
+Cycle Pipeline::retire(const DecodedInstruction &d, const Word PC, const Word next_PC,
+                       const Cycle t_fetch, const Cycle t_memory) {
+  // IF is free once the previous instruction moved on to ID
+  const Cycle fetch = std::max(prev_id, redirect);
+  stats.flush_cycles += fetch - prev_id;
+  const Cycle decode = std::max(fetch + t_fetch, prev_ex);
+  stats.fetch_stalls += t_fetch > 1 ? t_fetch - 1 : 0;
+
+  // sources are needed when EX starts; unused ones are r0, which is always
+  // ready
+  const Cycle in_order = std::max(decode + 1, prev_mem);
+  Cycle execute = in_order;
+  bool from_load = false;
+  for (const std::uint8_t rs : {d.rs1, d.rs2}) {
+    if (ready[rs] > execute) {
+      execute = ready[rs];
+      from_load = loaded[rs];
+    }
+  }
+  (from_load ? stats.load_use_stalls : stats.data_stalls) += execute - in_order;
+
+  const Cycle access = std::max(execute + 1, prev_wb);
+  const Cycle t_mem = std::max<Cycle>(t_memory, 1);
+  stats.memory_stalls += t_mem - 1;
+  const Cycle writeback = std::max(access + t_mem, prev_done);
+  const Cycle done = writeback + 1;
+
+  const bool load = isLoad(d.op);
+  if (d.rd != no_of_registers and d.rd != 0) {
+    // a value computed in EX is there at the end of EX, a loaded one at the
+    // end of MEM; once written back it is read in ID, one cycle before EX
+    Cycle available = writeback + 1;
+    if (config.forward_mem)
+      available = writeback;
+    if (config.forward_ex and not load)
+      available = access;
+    ready[d.rd] = available;
+    loaded[d.rd] = load;
+  }
+
+  // branches and jumps are resolved in EX while fetch went on with its
+  // prediction; if that was wrong the next fetch comes flush cycles after the
+  // one following ID would have
+  const bool jump = isJump(d.op);
+  const bool mispredicted =
+      predictor ? not predictor->resolve(d, PC, next_PC) : jump or next_PC != PC + 4;
+  if (mispredicted)
+    redirect = execute - 1 + config.flush;
+
+  prev_id = decode;
+  prev_ex = execute;
+  prev_mem = access;
+  prev_wb = writeback;
+  const Cycle t = done - prev_done;
+  prev_done = done;
+  ++stats.instructions;
+  stats.cycles += t;
+  return t;
+}
+
+void Pipeline::save(std::ostream &os) const {
+  writeValue(os, config.forward_ex);
+  writeValue(os, config.forward_mem);
+  writeValue(os, config.flush);
+  writeValue(os, predictor.has_value());
+  if (predictor)
+    predictor->save(os);
+  writeValue(os, prev_id);
+  writeValue(os, prev_ex);
+  writeValue(os, prev_mem);
+  writeValue(os, prev_wb);
+  writeValue(os, prev_done);
+  writeValue(os, redirect);
+  writeValue(os, ready);
+  writeValue(os, loaded);
+  writeValue(os, stats);
+}
+
+bool Pipeline::restore(std::istream &is) {
+  if (readValue<bool>(is) != config.forward_ex or readValue<bool>(is) != config.forward_mem or
+      readValue<Cycle>(is) != config.flush or readValue<bool>(is) != predictor.has_value())
+    return false;
+  if (predictor and not predictor->restore(is))
+    return false;
+  prev_id = readValue<Cycle>(is);
+  prev_ex = readValue<Cycle>(is);
+  prev_mem = readValue<Cycle>(is);
+  prev_wb = readValue<Cycle>(is);
+  prev_done = readValue<Cycle>(is);
+  redirect = readValue<Cycle>(is);
+  ready = readValue<decltype(ready)>(is);
+  loaded = readValue<decltype(loaded)>(is);
+  stats = readValue<PipelineStats>(is);
+  return true;
+}
+
+void Pipeline::dump(std::ostream &os) const {
+  os << "Pipeline\n";
+  os << "========\n";
+  os << "Instructions: " << stats.instructions << "\tCycles: " << stats.cycles << "\tCPI: "
+     << static_cast<long double>(stats.cycles) / stats.instructions << "\n";
+  os << "Fetch Stalls: " << stats.fetch_stalls << "\tMemory Stalls: " << stats.memory_stalls
+     << "\n";
+  os << "Data Hazard Stalls: " << stats.data_stalls << "\tLoad-Use Stalls: "
+     << stats.load_use_stalls << "\tBranch Flush Cycles: " << stats.flush_cycles << "\n";
+  if (predictor) {
+    os << "\n";
+    predictor->dump(os);
+  }
+}
@@ -0,0 +1,93 @@
+#ifndef __PIPELINE_H
+#define __PIPELINE_H
+
+#include "BranchPredictor.hpp"
+#include <array>    // for std::array
+#include <cstdint>  // for std::uint64_t
+#include <optional> // for std::optional
+#include <string>
+
+// how cycles are charged to instructions
+enum class Timing {
+  Serial,   // every stage of an instruction one after another, no overlap
+  Pipeline, // in-order IF/ID/EX/MEM/WB pipeline, see Pipeline
+  Event     // overlapping memory accesses driven by completion events, see EventCore
+};
+
+struct PipelineConfig {
+  // forwarding paths into EX: from the end of EX (ALU results the cycle after
+  // they are computed) and from the end of MEM (loaded values and older ALU
+  // results); without either a value is read from the register file in ID
+  // once WB has written it
+  bool forward_ex = true, forward_mem = true;
+  // fetch cycles lost by a mispredicted branch or jump, which is resolved in
+  // EX; the default of 2 refetches right after EX, flushing the two younger
+  // instructions
+  Cycle flush = 2;
+  // without a predictor fetch goes on sequentially, so every taken branch
+  // and jump is mispredicted
+  std::optional<PredictorConfig> predictor;
+};
+
+// Parses "forward=none|ex|mem|...,flush=<cycles>" on top of base, e.g.
+// "forward=mem" keeps only the MEM path.
+PipelineConfig parsePipelineConfig(const std::string &spec, PipelineConfig base = {});
+
+struct PipelineStats {
+  std::uint64_t instructions = 0;
+  Cycle cycles = 0;
+  // cycles instructions waited beyond a single cycle for IF and MEM
+  Cycle fetch_stalls = 0, memory_stalls = 0;
+  // cycles instructions waited in ID for operands, split by whether the
+  // operand came from a load
+  Cycle data_stalls = 0, load_use_stalls = 0;
+  // fetch cycles lost to mispredicted branches and jumps
+  Cycle flush_cycles = 0;
+};
+
+// Timing of an in-order five-stage pipeline over the functional core. It is
+// told about every instruction as it retires, with the latencies its fetch
+// and memory access had, and works out the cycle each stage was entered in:
+// a stage holds one instruction at a time, so an instruction stalls while
+// the one ahead of it has not moved on, while its operands are not available
+// on a forwarding path, and while a mispredicted branch redirects fetch.
+class Pipeline final {
+  const PipelineConfig config;
+  std::optional<BranchPredictor> predictor;
+
+  // stage entry cycles of the previous instruction
+  Cycle prev_id = 0, prev_ex = 0, prev_mem = 0, prev_wb = 0, prev_done = 0;
+  // earliest fetch after a taken branch or jump
+  Cycle redirect = 0;
+  // earliest cycle each register's value can enter EX, and whether a load
+  // produces it
+  std::array<Cycle, no_of_registers> ready{};
+  std::array<bool, no_of_registers> loaded{};
+
+  PipelineStats stats;
+
+public:
+  explicit Pipeline(const PipelineConfig &config_ = {}) : config(config_) {
+    if (config.predictor)
+      predictor.emplace(*config.predictor);
+  }
+
+  // Accounts for an instruction that executed at PC and continued at next_PC,
+  // with the given fetch and memory access latencies (0 for no access).
+  // Returns the cycles it added to the run, from the previous instruction
+  // leaving WB to this one leaving it.
+  Cycle retire(const DecodedInstruction &d, const Word PC, const Word next_PC,
+               const Cycle t_fetch, const Cycle t_memory);
+
+  const PipelineStats &getStats() const { return stats; }
+
+  // Checkpointing of the stage times, operand readiness, predictor and
+  // statistics. restore only takes state saved by a pipeline of the same
+  // configuration and returns false, changing nothing, for any other.
+  void save(std::ostream &os) const;
+  bool restore(std::istream &is);
+
+  void dump(std::ostream &os) const;
+};
+
+#endif /* end of __PIPELINE_H */
@@ -0,0 +1,138 @@
+#include "Prefetcher.hpp"
+#include <algorithm> // for std::min
+
+namespace {
+
+// Fetches the blocks following every missed block, and keeps going as the
+// prefetched ones are demanded (tagged prefetching).
+class NextLinePrefetcher final : public Prefetcher {
+  const Word degree, distance, block_bytes;
+
+public:
+  NextLinePrefetcher(const PrefetcherConfig &config, const Word block_bytes_)
+      : degree(config.degree), distance(config.distance), block_bytes(block_bytes_) {}
+
+  void observe(const Word, const Word address, const bool trigger,
+               std::vector<Word> &candidates) override {
+    if (not trigger)
+      return;
+    const Word block = address & ~(block_bytes - 1);
+    for (Word i = 0; i < degree; ++i)
+      candidates.push_back(block + (distance + i) * block_bytes);
+  }
+};
+
+// Reference prediction table indexed by the PC of loads and stores. An entry
+// remembers the last address and stride of its instruction, and prefetches
+// ahead once the same stride was seen twice in a row.
+class StridePrefetcher final : public Prefetcher {
+  const Word degree, distance;
+
+  struct Entry {
+    Word PC = no_PC, last = 0, stride = 0;
+    // saturating at 3, prefetching from 2
+    unsigned confidence = 0;
+  };
+  std::vector<Entry> table;
+
+public:
+  StridePrefetcher(const PrefetcherConfig &config)
+      : degree(config.degree), distance(config.distance), table(config.table) {}
+
+  void observe(const Word PC, const Word address, const bool,
+               std::vector<Word> &candidates) override {
+    if (PC == no_PC)
+      return;
+    Entry &e = table[(PC >> 2) & (table.size() - 1)];
+    if (e.PC != PC) {
+      e = Entry{PC, address, 0, 0};
+      return;
+    }
+    const Word delta = address - e.last;
+    e.last = address;
+    if (delta == e.stride) {
+      e.confidence = std::min(e.confidence + 1, 3u);
+    } else {
+      // a stride survives one irregular access
+      if (e.confidence > 0)
+        --e.confidence;
+      if (e.confidence == 0)
+        e.stride = delta;
+    }
+    if (e.confidence >= 2 and e.stride != 0)
+      for (Word i = 0; i < degree; ++i)
+        candidates.push_back(address + (distance + i) * e.stride);
+  }
+};
+
+// Tracks a few sequential streams of blocks, either direction. A miss next to
+// the last block of a stream confirms its direction, after which every
+// trigger along it prefetches further ahead; other misses start new streams
+// in place of the least recently used one.
+class StreamPrefetcher final : public Prefetcher {
+  const Word degree, distance, block_bytes;
+
+  struct Stream {
+    bool valid = false;
+    Word last = 0;
+    // +1 or -1 in blocks once confirmed, 0 before
+    int direction = 0;
+    std::uint64_t used = 0;
+  };
+  std::vector<Stream> streams;
+  std::uint64_t clock = 0;
+
+public:
+  StreamPrefetcher(const PrefetcherConfig &config, const Word block_bytes_)
+      : degree(config.degree), distance(config.distance), block_bytes(block_bytes_),
+        streams(config.table) {}
+
+  void observe(const Word, const Word address, const bool trigger,
+               std::vector<Word> &candidates) override {
+    if (not trigger)
+      return;
+    const Word block = address & ~(block_bytes - 1);
+    Stream *victim = &streams[0];
+    for (Stream &s : streams) {
+      if (s.valid) {
+        const int direction = block == s.last + block_bytes   ? 1
+                              : block == s.last - block_bytes ? -1
+                                                              : 0;
+        if (direction != 0 and (s.direction == 0 or s.direction == direction)) {
+          s.direction = direction;
+          s.last = block;
+          s.used = ++clock;
+          for (Word i = 0; i < degree; ++i)
+            candidates.push_back(block + direction * static_cast<SignedWord>(distance + i) *
+                                             static_cast<SignedWord>(block_bytes));
+          return;
+        }
+        // a block the stream already passed, e.g. a miss on a line it
+        // prefetched and lost again
+        if (block == s.last)
+          return;
+      }
+      if (not s.valid or (victim->valid and s.used < victim->used))
+        victim = &s;
+    }
+    *victim = Stream{true, block, 0, ++clock};
+  }
+};
+
+} // namespace
+
+std::unique_ptr<Prefetcher> makePrefetcher(const PrefetcherConfig &config,
+                                           const Word block_bytes) {
+  switch (config.kind) {
+  case PrefetcherKind::None:
+    return nullptr;
+  case PrefetcherKind::NextLine:
+    return std::make_unique<NextLinePrefetcher>(config, block_bytes);
+  case PrefetcherKind::Stride:
+    return std::make_unique<StridePrefetcher>(config);
+  case PrefetcherKind::Stream:
+    return std::make_unique<StreamPrefetcher>(config, block_bytes);
+  default:
+    throw std::runtime_error("unknown prefetcher");
+  }
+}
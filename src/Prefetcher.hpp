@@ -0,0 +1,58 @@
+#ifndef __PREFETCHER_H
+#define __PREFETCHER_H
+
+#include "common.hpp"
+#include <cstdint> // for std::uint64_t
+#include <memory>  // for std::unique_ptr
+#include <vector>  // for std::vector
+
+enum class PrefetcherKind { None, NextLine, Stride, Stream };
+
+struct PrefetcherConfig {
+  PrefetcherKind kind = PrefetcherKind::None;
+  // blocks prefetched per trigger
+  Word degree = 1;
+  // how far ahead the first of them is, in blocks (in strides for the stride
+  // prefetcher)
+  Word distance = 1;
+  // reference prediction table entries of the stride prefetcher (a power of
+  // 2), or streams tracked by the stream prefetcher
+  Word table = 16;
+};
+
+// PC of accesses that have none, fetches and accesses replayed or coming
+// from the level above; the stride prefetcher ignores them
+constexpr Word no_PC = ~0u;
+
+struct PrefetchStats {
+  std::uint64_t issued = 0;
+  // demanded after their data arrived, or before it did
+  std::uint64_t useful = 0, late = 0;
+  // evicted without ever being demanded
+  std::uint64_t useless = 0;
+  // not issued since every miss register was taken
+  std::uint64_t dropped = 0;
+  // cycles the levels below spent on prefetches (victim writebacks included)
+  // and words they moved, none of which is charged to demand accesses
+  std::uint64_t memory_cycles = 0, words = 0;
+};
+
+// Decides what to prefetch from the stream of demand accesses a cache sees.
+// Implementations are picked at runtime by makePrefetcher.
+class Prefetcher {
+public:
+  virtual ~Prefetcher() = default;
+
+  // Called on every demand access at (byte) address by the instruction at PC.
+  // trigger is set on misses and on the first demand of a prefetched line.
+  // Appends the addresses to prefetch to candidates; the cache drops those it
+  // already holds.
+  virtual void observe(const Word PC, const Word address, const bool trigger,
+                       std::vector<Word> &candidates) = 0;
+};
+
+// block_bytes is the block size of the cache the prefetcher serves; returns
+// nullptr for PrefetcherKind::None
+std::unique_ptr<Prefetcher> makePrefetcher(const PrefetcherConfig &config, const Word block_bytes);
+
+#endif /* end of __PREFETCHER_H */
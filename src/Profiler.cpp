@@ -0,0 +1,185 @@
+#include "Profiler.hpp"
+#include <algorithm> // for std::sort, std::min
+#include <fstream>   // for reading symbol files
+#include <iterator>  // for std::prev
+#include <sstream>   // for parsing symbol lines
+
+Symbols::Symbols(const std::string &path) {
+  std::ifstream file(path);
+  if (not file)
+    throw std::runtime_error("cannot read symbols '" + path + "'");
+  for (std::string line; std::getline(file, line);) {
+    std::istringstream fields(line);
+    std::string address, name, nm_name;
+    if (not(fields >> address >> name))
+      continue;
+    // nm puts a type letter between the address and the name, and lists
+    // undefined symbols without an address
+    if (fields >> nm_name)
+      name = nm_name;
+    if (address.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos)
+      continue;
+    labels[std::stoul(address, nullptr, 16)] = name;
+  }
+}
+
+const std::pair<const Word, std::string> *Symbols::find(const Word address) const {
+  auto it = labels.upper_bound(address);
+  if (it == labels.begin())
+    return nullptr;
+  return &*std::prev(it);
+}
+
+std::string Symbols::describe(const Word address) const {
+  const auto *label = find(address);
+  if (label == nullptr) {
+    std::ostringstream hex;
+    hex << "0x" << std::hex << std::setfill('0') << std::setw(XLEN / 4) << address;
+    return hex.str();
+  }
+  if (label->first == address)
+    return label->second;
+  return label->second + "+" + std::to_string(address - label->first);
+}
+
+std::string Symbols::region(const Word address) const {
+  const auto *label = find(address);
+  return label ? label->second : "(unlabeled)";
+}
+
+Profiler::Profiler(const Symbols &symbols_) : symbols(symbols_) {
+  // the empty stack, outside of any call
+  stack_ids[{}] = 0;
+  stacks.emplace_back();
+}
+
+void Profiler::setProgram(const Word begin, const Word end) {
+  // a restarted program keeps what its PCs were charged before
+  for (const auto &[PC, profile] : collect())
+    others[PC] = profile;
+  program_begin = begin;
+  program.assign((end - begin) / 4, PCProfile{});
+  for (auto it = others.begin(); it != others.end();) {
+    const Word idx = (it->first - program_begin) / 4;
+    if (idx < program.size()) {
+      program[idx] = it->second;
+      it = others.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void Profiler::enterStack() {
+  auto [it, inserted] = stack_ids.try_emplace(call_stack, stacks.size());
+  if (inserted)
+    stacks.push_back(call_stack);
+  stack_id = it->second;
+}
+
+void Profiler::record(const DecodedInstruction &d, const Word PC, const Cycle t,
+                      const Cycle t_fetch, const Cycle t_execute, const Cycle t_memory,
+                      const std::uint64_t misses) {
+  PCProfile &profile = at(PC);
+  ++profile.count;
+  profile.cycles += t;
+  profile.fetch_cycles += t_fetch;
+  profile.execute_cycles += t_execute;
+  profile.memory_cycles += t_memory;
+  profile.misses += misses;
+  stack_cycles[static_cast<std::uint64_t>(stack_id) << 32 | PC] += t;
+
+  if (isCall(d)) {
+    call_stack.push_back(PC);
+    enterStack();
+  } else if (isReturn(d) and not call_stack.empty()) {
+    call_stack.pop_back();
+    enterStack();
+  }
+}
+
+std::map<Word, PCProfile> Profiler::collect() const {
+  std::map<Word, PCProfile> result(others.begin(), others.end());
+  for (Word idx = 0; idx < program.size(); ++idx)
+    if (program[idx].count)
+      result[program_begin + 4 * idx] = program[idx];
+  return result;
+}
+
+void Profiler::dump(std::ostream &os) const {
+  const std::map<Word, PCProfile> pcs = collect();
+  Cycle total = 0;
+  for (const auto &[PC, profile] : pcs)
+    total += profile.cycles;
+
+  // PCs are summed up by the label they follow, which for assembler labels
+  // is the loop or function they are in
+  std::map<std::string, PCProfile> regions;
+  for (const auto &[PC, profile] : pcs) {
+    PCProfile &region = regions[symbols.region(PC)];
+    region.count += profile.count;
+    region.cycles += profile.cycles;
+    region.memory_cycles += profile.memory_cycles;
+    region.misses += profile.misses;
+  }
+
+  auto table = [&](const char *title, std::vector<std::pair<std::string, PCProfile>> rows,
+                   const std::size_t limit) {
+    std::sort(rows.begin(), rows.end(),
+              [](const auto &a, const auto &b) { return a.second.cycles > b.second.cycles; });
+    os << std::left;
+    os << std::setw(24) << title << std::setw(14) << "instructions" << std::setw(14) << "cycles"
+       << std::setw(10) << "share" << std::setw(15) << "memory cycles"
+       << "misses\n";
+    for (std::size_t i = 0; i < std::min(rows.size(), limit); ++i) {
+      const PCProfile &p = rows[i].second;
+      std::ostringstream share;
+      share << std::fixed << std::setprecision(2) << (total ? 100.0L * p.cycles / total : 0.0L)
+            << "%";
+      os << std::setw(24) << rows[i].first << std::setw(14) << p.count << std::setw(14)
+         << p.cycles << std::setw(10) << share.str() << std::setw(15) << p.memory_cycles
+         << p.misses << "\n";
+    }
+    os << std::right;
+  };
+
+  os << "Profile\n";
+  os << "=======\n";
+  if (not symbols.empty()) {
+    table("label", {regions.begin(), regions.end()}, regions.size());
+    os << "\n";
+  }
+  std::vector<std::pair<std::string, PCProfile>> hottest;
+  for (const auto &[PC, profile] : pcs)
+    hottest.emplace_back(symbols.describe(PC), profile);
+  table("pc", hottest, 10);
+}
+
+void Profiler::writeCSV(std::ostream &os) const {
+  os << "pc,label,count,cycles,fetch_cycles,execute_cycles,memory_cycles,misses\n";
+  for (const auto &[PC, p] : collect()) {
+    os << "0x" << std::hex << std::setfill('0') << std::setw(XLEN / 4) << PC << std::dec
+       << std::setfill(' ') << "," << symbols.describe(PC) << "," << p.count << "," << p.cycles
+       << "," << p.fetch_cycles << "," << p.execute_cycles << "," << p.memory_cycles << ","
+       << p.misses << "\n";
+  }
+}
+
+void Profiler::writeFolded(std::ostream &os) const {
+  // frames are the labels of the call sites and of the PC, so PCs under the
+  // same label and stack fold into one line; without symbols every PC is a
+  // frame of its own
+  auto frame = [&](const Word PC) {
+    return symbols.empty() ? symbols.describe(PC) : symbols.region(PC);
+  };
+  std::map<std::string, Cycle> folded;
+  for (const auto &[key, cycles] : stack_cycles) {
+    std::string frames;
+    for (const Word call : stacks[key >> 32])
+      frames += frame(call) + ";";
+    folded[frames + frame(static_cast<Word>(key))] += cycles;
+  }
+  for (const auto &[frames, cycles] : folded)
+    if (cycles)
+      os << frames << " " << cycles << "\n";
+}
@@ -0,0 +1,93 @@
+#ifndef __PROFILER_H
+#define __PROFILER_H
+
+#include "Decoder.hpp"
+#include <cstdint>       // for std::uint32_t, std::uint64_t
+#include <map>           // for std::map
+#include <string>
+#include <unordered_map> // for std::unordered_map
+#include <vector>        // for std::vector
+
+// Labels of a program by address. A symbol file has one symbol per line, an
+// address in hex followed by the name, optionally with a type letter in
+// between, so both `asm.py --symbols` files and `nm` output of ELF files can
+// be read.
+class Symbols final {
+  std::map<Word, std::string> labels;
+
+public:
+  Symbols() = default;
+  explicit Symbols(const std::string &path);
+
+  // the label at or closest below address, nullptr if there is none
+  const std::pair<const Word, std::string> *find(const Word address) const;
+
+  // the label of address with the offset from it, e.g. "loop+8", or the
+  // address in hex if no label precedes it
+  std::string describe(const Word address) const;
+
+  // the label of address, "(unlabeled)" if no label precedes it
+  std::string region(const Word address) const;
+
+  bool empty() const { return labels.empty(); }
+};
+
+// what the instructions at a PC cost over the run
+struct PCProfile {
+  std::uint64_t count = 0;
+  // cycles the timing model charged, and the latencies they came from
+  Cycle cycles = 0, fetch_cycles = 0, execute_cycles = 0, memory_cycles = 0;
+  // misses in every cache level caused by the instructions' accesses
+  std::uint64_t misses = 0;
+};
+
+// Per-PC hot spot profile of a run. Calls and returns (jumps linking ra or
+// t0, and jumps through them) are followed on a shadow stack so that cycles
+// can also be attributed to the labels of the call sites leading to them, as
+// folded stacks for flame graphs.
+class Profiler final {
+  const Symbols symbols;
+
+  // program memory is profiled densely, anything else in a map
+  Word program_begin = 0;
+  std::vector<PCProfile> program;
+  std::unordered_map<Word, PCProfile> others;
+
+  // PCs of the active calls, and the id of that stack
+  std::vector<Word> call_stack;
+  std::uint32_t stack_id = 0;
+  std::map<std::vector<Word>, std::uint32_t> stack_ids;
+  std::vector<std::vector<Word>> stacks;
+  // cycles by stack id << 32 | PC
+  std::unordered_map<std::uint64_t, Cycle> stack_cycles;
+
+  PCProfile &at(const Word PC) {
+    const Word idx = (PC - program_begin) / 4;
+    return idx < program.size() ? program[idx] : others[PC];
+  }
+
+  void enterStack();
+
+  // every profiled PC, in address order
+  std::map<Word, PCProfile> collect() const;
+
+public:
+  explicit Profiler(const Symbols &symbols_ = {});
+
+  void setProgram(const Word begin, const Word end);
+
+  // accounts for an instruction executed at PC, following calls and returns
+  void record(const DecodedInstruction &d, const Word PC, const Cycle t, const Cycle t_fetch,
+              const Cycle t_execute, const Cycle t_memory, const std::uint64_t misses);
+
+  // the labels and PCs taking the most cycles
+  void dump(std::ostream &os) const;
+
+  // one row per PC
+  void writeCSV(std::ostream &os) const;
+
+  // "caller;callee;label cycles" lines, for flamegraph.pl and the like
+  void writeFolded(std::ostream &os) const;
+};
+
+#endif /* end of __PROFILER_H */
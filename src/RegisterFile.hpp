@@ -1,7 +1,8 @@
 #ifndef __REGISTER_FILE_H
 #define __REGISTER_FILE_H
 
-#include "common.hpp"
+#include "Serialize.hpp"
+#include <array> // for std::array
 
 class RegisterFile final {
 
@@ -26,6 +27,16 @@ public:
       RF[idx] = val;
   }
 
+  void save(std::ostream &os) const {
+    for (const Word reg : RF)
+      writeValue(os, reg);
+  }
+
+  void restore(std::istream &is) {
+    for (Word &reg : RF)
+      reg = readValue<Word>(is);
+  }
+
   void dump(std::ostream &os) {
     // formatting change as right looks bad
     os << std::left;
@@ -0,0 +1,146 @@
+/* Sampled simulation, after SMARTS.
+ *
+ * Most instructions are fast-forwarded: executed functionally, without
+ * timing and without touching the caches' statistics or replacement state.
+ * At the end of every sampling interval a warm-up window is run timed to
+ * bring the caches back up to date, followed by a detail window whose cycles
+ * per instruction are measured. The mean CPI of the detail windows, with a
+ * confidence interval from their variance, is extrapolated to the whole run.
+ */
+#include "Simulation.hpp"
+#include "Sweep.hpp" // for parseGridAxes
+#include <cmath>     // for std::erf, std::sqrt
+
+SamplingConfig parseSamplingConfig(const std::string &spec) {
+  SamplingConfig config;
+  for (const auto &[key, values] : parseGridAxes(spec)) {
+    if (values.size() != 1)
+      throw std::runtime_error("sampling setting '" + key + "' takes a single value");
+    if (key == "interval")
+      config.interval = std::stoull(values[0]);
+    else if (key == "warmup")
+      config.warmup = std::stoull(values[0]);
+    else if (key == "detail")
+      config.detail = std::stoull(values[0]);
+    else if (key == "confidence")
+      config.confidence = std::stod(values[0]);
+    else
+      throw std::runtime_error("unknown sampling setting '" + key + "'");
+  }
+  if (config.detail == 0 or config.warmup + config.detail > config.interval)
+    throw std::runtime_error("a sampling interval must hold its warm-up and detail windows");
+  if (not (config.confidence > 0 and config.confidence < 100))
+    throw std::runtime_error("confidence must be between 0 and 100 percent");
+  return config;
+}
+
+namespace {
+
+// z such that a standard normal variable lies within [-z, z] with the given
+// probability, by bisection as erf is monotonic
+double normalQuantile(const double probability) {
+  double low = 0, high = 10;
+  for (int i = 0; i < 100; ++i) {
+    const double z = (low + high) / 2;
+    (std::erf(z / std::sqrt(2.0)) < probability ? low : high) = z;
+  }
+  return (low + high) / 2;
+}
+
+} // namespace
+
+void printSampling(std::ostream &os, const SamplingResult &result) {
+  os << "Sampled Simulation\n";
+  os << "==================\n";
+  os << "Instructions: " << result.instructions
+     << "\tDetailed Instructions: " << result.detailed_instructions << "\n";
+  os << "Detail Windows: " << result.windows.size() << "\n";
+
+  const std::size_t n = result.windows.size();
+  if (n == 0) {
+    os << "No complete detail window, the program is shorter than a sampling interval\n";
+    return;
+  }
+  const double detail = result.config.detail;
+  double mean = 0;
+  for (const Cycle t : result.windows)
+    mean += t / detail;
+  mean /= n;
+  const double estimate = mean * result.instructions;
+  if (n < 2) {
+    os << "CPI: " << mean << " (too few windows for a confidence interval)\n";
+    os << "Estimated Total Cycles: " << static_cast<std::uint64_t>(std::llround(estimate))
+       << "\n";
+    return;
+  }
+
+  // sample variance of the per-window CPI
+  double variance = 0;
+  for (const Cycle t : result.windows)
+    variance += (t / detail - mean) * (t / detail - mean);
+  variance /= n - 1;
+  const double half_width =
+      normalQuantile(result.config.confidence / 100) * std::sqrt(variance / n);
+  os << "CPI: " << mean << " +- " << half_width << " (" << result.config.confidence
+     << "% confidence)\n";
+  os << "Estimated Total Cycles: " << static_cast<std::uint64_t>(std::llround(estimate))
+     << " +- " << static_cast<std::uint64_t>(std::llround(half_width * result.instructions))
+     << "\n";
+}
+
+std::uint64_t Simulation::fastForward(const std::uint64_t n) {
+  memory.setFunctional(true);
+  std::uint64_t done = 0;
+  for (; done < n and not finished(); ++done) {
+    const Word inst = memory.fetchInstruction(PC).first;
+    PC = execute(getDecoded(PC, inst), PC).first;
+  }
+  memory.setFunctional(false);
+  return done;
+}
+
+std::uint64_t Simulation::runTimed(const std::uint64_t n, Cycle &time) {
+  std::uint64_t done = 0;
+  for (; done < n and not finished(); ++done)
+    time += step();
+  return done;
+}
+
+SamplingResult Simulation::sample(const SamplingConfig &config) {
+  SamplingResult result;
+  result.config = config;
+  const std::uint64_t fast = config.interval - config.warmup - config.detail;
+
+  while (not finished()) {
+    result.instructions += fastForward(fast);
+    Cycle t = 0;
+    result.instructions += runTimed(config.warmup, t);
+    t = 0;
+    const std::uint64_t detailed = runTimed(config.detail, t);
+    result.instructions += detailed;
+    // a window cut short by the end of the program is left out
+    if (detailed == config.detail) {
+      result.detailed_instructions += detailed;
+      result.windows.push_back(t);
+    }
+  }
+
+  if (tracer.enabled(TraceLevel::Summary)) {
+    printSampling(output, result);
+    output << "\n";
+    if (pipeline) {
+      pipeline->dump(output);
+      output << "\n";
+    }
+    if (event_core) {
+      event_core->dump(output);
+      output << "\n";
+    }
+    if (profiler) {
+      profiler->dump(output);
+      output << "\n";
+    }
+    memory.dump(output);
+  }
+  return result;
+}
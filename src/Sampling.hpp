@@ -0,0 +1,35 @@
+#ifndef __SAMPLING_H
+#define __SAMPLING_H
+
+#include "common.hpp"
+#include <cstdint> // for std::uint64_t
+#include <string>
+#include <vector>  // for std::vector
+
+// Layout of a sampled run, in instructions. Every interval ends with a
+// warm-up window, which runs timed to bring the caches up to date, followed
+// by a measured detail window; the rest of the interval is fast-forwarded
+// functionally.
+struct SamplingConfig {
+  std::uint64_t interval = 10000, warmup = 2000, detail = 1000;
+  // of the confidence interval of the estimates, in percent
+  double confidence = 95;
+};
+
+// Parses "interval=<n>,warmup=<n>,detail=<n>,confidence=<percent>" on top of
+// the defaults.
+SamplingConfig parseSamplingConfig(const std::string &spec);
+
+struct SamplingResult {
+  SamplingConfig config;
+  // every instruction executed, and those of the complete detail windows
+  std::uint64_t instructions = 0, detailed_instructions = 0;
+  // cycles of each complete detail window
+  std::vector<Cycle> windows;
+};
+
+// Prints the CPI of the detail windows and the total cycles extrapolated from
+// it, both with their confidence intervals.
+void printSampling(std::ostream &os, const SamplingResult &result);
+
+#endif /* end of __SAMPLING_H */
@@ -0,0 +1,61 @@
+#ifndef __SERIALIZE_H
+#define __SERIALIZE_H
+
+#include "common.hpp"
+#include <sstream> // for generator states
+#include <string>
+#include <vector>  // for std::vector
+
+// Helpers for binary checkpoints. Values are stored as the host lays them out,
+// so checkpoints are only read back on hosts of the same byte order.
+
+template <typename T> void writeValue(std::ostream &os, const T &value) {
+  os.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <typename T> T readValue(std::istream &is) {
+  T value;
+  if (not is.read(reinterpret_cast<char *>(&value), sizeof(T)))
+    throw std::runtime_error("truncated checkpoint");
+  return value;
+}
+
+template <typename T> void writeArray(std::ostream &os, const std::vector<T> &values) {
+  writeValue<std::uint64_t>(os, values.size());
+  os.write(reinterpret_cast<const char *>(values.data()), values.size() * sizeof(T));
+}
+
+// arrays are restored into storage of the size they were saved from
+template <typename T> void readArray(std::istream &is, std::vector<T> &values) {
+  if (readValue<std::uint64_t>(is) != values.size())
+    throw std::runtime_error("checkpoint does not match the simulated machine");
+  if (not is.read(reinterpret_cast<char *>(values.data()), values.size() * sizeof(T)))
+    throw std::runtime_error("truncated checkpoint");
+}
+
+inline void writeString(std::ostream &os, const std::string &s) {
+  writeValue<std::uint64_t>(os, s.size());
+  os.write(s.data(), s.size());
+}
+
+inline std::string readString(std::istream &is) {
+  std::string s(readValue<std::uint64_t>(is), '\0');
+  if (not is.read(s.data(), s.size()))
+    throw std::runtime_error("truncated checkpoint");
+  return s;
+}
+
+// standard generators only define a textual form of their state
+template <typename Engine> void writeEngine(std::ostream &os, const Engine &engine) {
+  std::ostringstream state;
+  state << engine;
+  writeString(os, state.str());
+}
+
+template <typename Engine> void readEngine(std::istream &is, Engine &engine) {
+  std::istringstream state(readString(is));
+  if (not(state >> engine))
+    throw std::runtime_error("corrupt checkpoint");
+}
+
+#endif /* end of __SERIALIZE_H */
@@ -1,404 +1,491 @@
 #include "Simulation.hpp"
-#include <fstream> // for reading binary
-
-// The following is necessary to be aligned, but clang-format breaks it.
-// clang-format off
-
-enum class INST_MASKS : Instruction {
-  // The RISC-V ISA keeps the source (rs1 and rs2) and destination (rd)
-  // registers at the same position in all formats to simplify decoding.
-  rs2      = 0b00000001111100000000000000000000,
-  rs1      = 0b00000000000011111000000000000000,
-  rd       = 0b00000000000000000000111110000000,
-  opcode   = 0b00000000000000000000000001111111,
-  // R-type
-  R_funct7 = 0b11111110000000000000000000000000,
-  R_funct3 = 0b00000000000000000111000000000000,
-  // I-Type
-  I_imm    = 0b11111111111100000000000000000000,
-  I_funct3 = 0b00000000000000000111000000000000,
-  // S-type
-  S_imm1   = 0b11111110000000000000000000000000,
-  S_funct3 = 0b00000000000000000111000000000000,
-  S_imm2   = 0b00000000000000000000111110000000,
-  // B-type
-  B_imm1   = 0b10000000000000000000000000000000,
-  B_imm3   = 0b01111110000000000000000000000000,
-  B_funct3 = 0b00000000000000000111000000000000,
-  B_imm4   = 0b00000000000000000000111100000000,
-  B_imm2   = 0b00000000000000000000000010000000,
-  // U-type
-  U_imm    = 0b11111111111111111111000000000000,
-  // J-type
-  J_imm1   = 0b10000000000000000000000000000000,
-  J_imm4   = 0b01111111111000000000000000000000,
-  J_imm3   = 0b00000000000100000000000000000000,
-  J_imm2   = 0b00000000000011111111000000000000
-};
-
-enum class INST_OFFSETS : int {
-  rs2      = 20,
-  rs1      = 15,
-  rd       = 7,
-  opcode   = 0,
-  // R-type
-  R_funct7 = 25,
-  R_funct3 = 12,
-  // I-Type
-  I_imm    = 20,
-  I_funct3 = 12,
-  // S-type
-  S_imm1   = 25,
-  S_funct3 = 12,
-  S_imm2   = 7,
-  // B-type
-  B_imm1   = 31,
-  B_imm3   = 25,
-  B_funct3 = 12,
-  B_imm4   = 8,
-  B_imm2   = 7,
-  // U-type
-  U_imm    = 12,
-  // J-type
-  J_imm1   = 31,
-  J_imm4   = 21,
-  J_imm3   = 20,
-  J_imm2   = 12
-};
-
-#define INST_GET(inst, type) \
-  ((inst & static_cast<Instruction>(INST_MASKS::type)) >> static_cast<int>(INST_OFFSETS::type))
-
-enum class INST_VALUES : Instruction {
-  // R-type
-  R_opcode         = 0x33,
-  R_funct3_ADD_SUB = 0x0,
-  R_funct7_ADD     = 0x00,
-  R_funct7_SUB     = 0x20,
-  R_funct3_SLL     = 0x1,
-  R_funct7_SLL     = 0x00,
-  R_funct3_XOR     = 0x4,
-  R_funct7_XOR     = 0x00,
-  R_funct3_SRA     = 0x5,
-  R_funct7_SRA     = 0x20,
-  R_funct3_OR      = 0x6,
-  R_funct7_OR      = 0x00,
-  R_funct3_AND     = 0x7,
-  R_funct7_AND     = 0x00,
-  // I-type
-  I_opcode_load    = 0x03,
-  I_funct3_LW      = 0x2,
-  I_opcode_ADDI    = 0x13,
-  I_funct3_ADDI    = 0x0,
-  I_opcode_JALR    = 0x67,
-  I_funct3_JALR    = 0x0,
-  // S-type
-  S_opcode         = 0x23,
-  S_funct3_SW      = 0x2,
-  // B-type
-  B_opcode         = 0x63,
-  B_funct3_BEQ     = 0x0,
-  B_funct3_BNE     = 0x1,
-  B_funct3_BLT     = 0x4,
-  B_funct3_BGE     = 0x5,
-  // U-type
-  U_opcode_LUI     = 0x37,
-  // J-type
-  J_opcode_JAL     = 0x6f
-};
-
-// clang-format on
-
-Word Simulation::initialize() {
-  std::ifstream file(binary_path);
-  if (!file)
-    throw std::runtime_error("File '" + binary_path + "' does not exist!");
-
-  Word idx = 0;
-  for (std::string line; std::getline(file, line); idx += ILEN / 8) {
-    if (line.length() != ILEN)
-      throw std::runtime_error("Binary file is not of the correct format!");
-    Instruction inst = 0;
-    for (int i = 0; i < ILEN; ++i)
-      inst = (inst << 1) | (line[i] == '1');
-    memory.writeDataToMainMemory(idx, inst);
-  }
+
+Program Simulation::initialize() {
+  Program program = loadProgram(memory, binary_path, format, load_address);
+  setup(program);
+  return program;
+}
+
+void Simulation::setup(const Program &program) {
+  program_begin = program.begin;
+  program_end = program.end;
+
+  // every program word starts out as the record of an all-zero word, which
+  // is then decoded for real the first time it is fetched
+  decoded.assign((program_end - program_begin) / 4, decode(0));
   // tell memory subsytem the program memory address range
-  memory.set_program_memory(0, idx);
-  // inform caller about program memory address range end
-  return idx;
+  memory.set_program_memory(program_begin, program_end);
+  // translations of a previous program are meaningless, and stores into this
+  // one invalidate the blocks of the page they hit
+  blocks.clear();
+  page_blocks.assign((program_end - program_begin + CodeWriteTracker::page_bytes - 1) /
+                         CodeWriteTracker::page_bytes,
+                     {});
+  memory.addCodeWriteHook([this](const Word begin, const Word end) { invalidateBlocks(begin, end); });
+  if (profiler) {
+    profiler->setProgram(program_begin, program_end);
+    misses_seen = memory.misses();
+  }
+}
+
+void Simulation::profile(const DecodedInstruction &d, const Word PC, const Cycle t,
+                         const Cycle t_fetch, const Cycle t_execute) {
+  // every miss since the last instruction was caused by this one
+  const std::uint64_t misses = memory.misses();
+  profiler->record(d, PC, t, t_fetch, t_execute - memory_time, memory_time,
+                   misses - misses_seen);
+  misses_seen = misses;
+}
+
+Cycle Simulation::simulate() {
+  start();
+  return resume();
+}
+
+Cycle Simulation::resume() {
+  // the registers a restored checkpoint or the stepping interface left
+  tracer.registers(RF);
+  switch (engine) {
+  case Engine::Interpreter:
+    elapsed += interpret(PC, end_PC);
+    break;
+  case Engine::BasicBlock:
+    elapsed += runBlocks(PC, end_PC);
+    break;
+  }
+  PC = end_PC;
+
+  tracer.summary(elapsed);
+  if (tracer.enabled(TraceLevel::Summary)) {
+    if (pipeline) {
+      pipeline->dump(output);
+      output << "\n";
+    }
+    if (event_core) {
+      event_core->dump(output);
+      output << "\n";
+    }
+    if (profiler) {
+      profiler->dump(output);
+      output << "\n";
+    }
+    memory.dump(output);
+  }
+  return elapsed;
 }
 
-void Simulation::simulate() {
-  Word end = initialize();
+Program Simulation::start() {
+  const Program program = initialize();
+  PC = program.entry;
+  end_PC = program.end;
+  return program;
+}
+
+void Simulation::start(const Program &program) {
+  setup(program);
+  PC = program.entry;
+  end_PC = program.end;
+}
+
+Cycle Simulation::step() {
+  tracePC(PC);
+  auto [inst, t_fetch] = memory.fetchInstruction(PC);
+  const DecodedInstruction &d = getDecoded(PC, inst);
+  auto [new_PC, t_execute] = execute(d, PC);
+  const Cycle t = charge(d, PC, new_PC, t_fetch, t_execute);
+  traceRetire(PC, d, t);
+  PC = new_PC;
+  elapsed += t;
+  return t;
+}
 
+Cycle Simulation::runUntil(const Word stop_PC, const Cycle max_cycles) {
+  Cycle t = 0;
+  while (PC != stop_PC and not finished() and t < max_cycles)
+    t += step();
+  return t;
+}
+
+Cycle Simulation::interpret(Word PC, const Word end) {
   Cycle time = 0;
 
-  for (Word PC = 0; PC != end; ) {
-    // dump PC
-    std::cout << "Program Counter : 0x" << std::hex << PC << std::dec << "\n";
+  while (PC != end) {
+    tracePC(PC);
 
-    auto [inst, t_fetch] = memory.getData(PC);
+    auto [inst, t_fetch] = memory.fetchInstruction(PC);
 
-    auto [new_PC, t_execute] = execute(inst, PC);
+    const DecodedInstruction &d = getDecoded(PC, inst);
+    auto [new_PC, t_execute] = execute(d, PC);
+    const Cycle t = charge(d, PC, new_PC, t_fetch, t_execute);
 
-    // dump registers
-    RF.dump(std::cout);
-    // dump timing
-    std::cout << "Time taken : " << t_fetch + t_execute << "\n\n";
+    traceRetire(PC, d, t);
 
     PC = new_PC;
-    time += t_fetch + t_execute;
+    time += t;
   }
 
-  std::cout << "Total simulation cycles : " << time << "\n\n";
-  memory.dump(std::cout);
+  return time;
+}
+
+// The table must list handlers in the order of the Operation enumerators.
+const std::array<Simulation::Handler, static_cast<std::size_t>(Operation::COUNT)>
+    Simulation::handlers = {
+        // R-type
+        &Simulation::execADD, &Simulation::execSUB, &Simulation::execSLL, &Simulation::execSLT,
+        &Simulation::execSLTU, &Simulation::execXOR, &Simulation::execSRL, &Simulation::execSRA,
+        &Simulation::execOR, &Simulation::execAND,
+        // R-type, M extension
+        &Simulation::execMUL, &Simulation::execMULH, &Simulation::execMULHSU,
+        &Simulation::execMULHU, &Simulation::execDIV, &Simulation::execDIVU, &Simulation::execREM,
+        &Simulation::execREMU,
+        // I-type
+        &Simulation::execADDI, &Simulation::execSLTI, &Simulation::execSLTIU,
+        &Simulation::execXORI, &Simulation::execORI, &Simulation::execANDI, &Simulation::execSLLI,
+        &Simulation::execSRLI, &Simulation::execSRAI, &Simulation::execLB, &Simulation::execLH,
+        &Simulation::execLW, &Simulation::execLBU, &Simulation::execLHU, &Simulation::execJALR,
+        &Simulation::execFENCE, &Simulation::execECALL, &Simulation::execEBREAK,
+        // S-type
+        &Simulation::execSB, &Simulation::execSH, &Simulation::execSW,
+        // B-type
+        &Simulation::execBEQ, &Simulation::execBNE, &Simulation::execBLT, &Simulation::execBGE,
+        &Simulation::execBLTU, &Simulation::execBGEU,
+        // U-type
+        &Simulation::execLUI, &Simulation::execAUIPC,
+        // J-type
+        &Simulation::execJAL,
+        // decoding failures
+        &Simulation::execInvalidOpcode, &Simulation::execInvalidInstruction};
+
+const DecodedInstruction &Simulation::getDecoded(const Word PC, const Instruction inst) {
+  // PCs below program memory wrap around to huge indices
+  const Word idx = (PC - program_begin) / 4;
+  if (idx < decoded.size()) {
+    DecodedInstruction &d = decoded[idx];
+    // the word may have been overwritten since it was last decoded
+    if (d.raw != inst)
+      d = decode(inst);
+    return d;
+  }
+  // executing outside program memory, nothing worth caching
+  uncached = decode(inst);
+  return uncached;
 }
 
-std::pair<Word, Cycle> Simulation::execute(const Instruction I, Word PC) {
+std::pair<Word, Cycle> Simulation::execute(const DecodedInstruction &d, Word PC) {
+  // handlers add the cycles of their memory access, if any
   Cycle t = 0;
 
-  // destination register, initialized with improbable value to know if inst
-  // doesn't have one
-  unsigned rd_idx = no_of_registers;
   // value to be written to destination in Writeback stage
-  Word result;
-  // not all of these will be used, but these need to be calculated in Decode stage
-  Word rs1, rs2, imm;
-
-  // DECODE
-  auto sext = [](Word x, int width) {
-    Word mask = 1u << (width - 1); // mask with only <width>th bit set
-    if (x & mask)                  // check if highest (sign) bit is set
-      x |= ~(mask - 1); // set all bits other than last <width-1> bits
-    return x;
-  };
-  switch (static_cast<INST_VALUES>(INST_GET(I, opcode))) {
-  case INST_VALUES::I_opcode_load:
-  case INST_VALUES::I_opcode_ADDI:
-  case INST_VALUES::I_opcode_JALR: {
-    rs1 = RF.getReg(INST_GET(I, rs1));
-    rd_idx = INST_GET(I, rd);
-    imm = sext(INST_GET(I, I_imm), 12);
-  } break;
-
-  case INST_VALUES::S_opcode: {
-    rs1 = RF.getReg(INST_GET(I, rs1));
-    rs2 = RF.getReg(INST_GET(I, rs2));
-    imm = sext(INST_GET(I, S_imm1) << 5 | INST_GET(I, S_imm2), 12);
-  } break;
-
-  case INST_VALUES::R_opcode: {
-    rs1 = RF.getReg(INST_GET(I, rs1));
-    rs2 = RF.getReg(INST_GET(I, rs2));
-    rd_idx = INST_GET(I, rd);
-  } break;
-
-  case INST_VALUES::U_opcode_LUI: {
-    rd_idx = INST_GET(I, rd);
-    imm = INST_GET(I, U_imm) << 12;
-  } break;
-
-  case INST_VALUES::B_opcode: {
-    rs1 = RF.getReg(INST_GET(I, rs1));
-    rs2 = RF.getReg(INST_GET(I, rs2));
-    imm = INST_GET(I, B_imm1) << 12 | INST_GET(I, B_imm2) << 11 |
-          INST_GET(I, B_imm3) << 5  | INST_GET(I, B_imm4) << 1;
-    imm = sext(imm, 13);
-  } break;
-
-  case INST_VALUES::J_opcode_JAL: {
-    rd_idx = INST_GET(I, rd);
-    imm = INST_GET(I, J_imm1) << 20 | INST_GET(I, J_imm2) << 12 |
-          INST_GET(I, J_imm3) << 11 | INST_GET(I, J_imm4) << 1;
-    imm = sext(imm, 21);
-  } break;
-
-  default:
-    throw std::runtime_error("invalid/unimplemented opcode");
-  }
-  // Decode takes 1 cycle as per project documentation
-  t += 1;
+  Word result = 0;
 
   // EXECUTE
-  switch (static_cast<INST_VALUES>(INST_GET(I, opcode))) {
-  case INST_VALUES::I_opcode_load: {
-    // LW
-    if (static_cast<INST_VALUES>(INST_GET(I, I_funct3)) == INST_VALUES::I_funct3_LW) {
-      auto [r_, t_] = memory.getData(rs1 + imm);
-      result = r_;
-      t += t_;
-    } else {
-      throw std::runtime_error("invalid/unimplemented instruction");
-    }
-
-    // standard increment as PC is unaffected
-    PC += 4;
-  } break;
-
-  case INST_VALUES::I_opcode_ADDI: {
-    // ADDI
-    if (static_cast<INST_VALUES>(INST_GET(I, I_funct3)) == INST_VALUES::I_funct3_ADDI)
-      result = rs1 + imm;
-    else
-      throw std::runtime_error("invalid/unimplemented instruction");
-
-    // standard increment as PC is unaffected
-    PC += 4;
-  } break;
-
-  case INST_VALUES::S_opcode: {
-    // SW
-    if (static_cast<INST_VALUES>(INST_GET(I, S_funct3)) == INST_VALUES::S_funct3_SW)
-      t += memory.writeData(rs1 + imm, rs2);
-    else
-      throw std::runtime_error("invalid/unimplemented instruction");
-
-    // standard increment as PC is unaffected
-    PC += 4;
-  } break;
-
-  case INST_VALUES::R_opcode: {
-    switch (static_cast<INST_VALUES>(INST_GET(I, R_funct3))) {
-    case INST_VALUES::R_funct3_ADD_SUB: {
-      switch (static_cast<INST_VALUES>(INST_GET(I, R_funct7))) {
-      // ADD
-      case INST_VALUES::R_funct7_ADD: {
-        result = rs1 + rs2;
-      } break;
-
-      // SUB
-      case INST_VALUES::R_funct7_SUB: {
-        result = rs1 - rs2;
-      } break;
-
-      default:
-        throw std::runtime_error("invalid/unimplemented instruction");
-      }
-    } break;
-
-    case INST_VALUES::R_funct3_SLL: {
-      // SLL
-      if (static_cast<INST_VALUES>(INST_GET(I, R_funct7)) == INST_VALUES::R_funct7_SLL)
-        result = rs1 << (rs2 & 0b11111);
-      else
-        throw std::runtime_error("invalid/unimplemented instruction");
-    } break;
-
-    case INST_VALUES::R_funct3_XOR: {
-      // XOR
-      if (static_cast<INST_VALUES>(INST_GET(I, R_funct7)) == INST_VALUES::R_funct7_XOR)
-        result = rs1 ^ rs2;
-      else
-        throw std::runtime_error("invalid/unimplemented instruction");
-    } break;
-
-    case INST_VALUES::R_funct3_SRA: {
-      // SRA
-      if (static_cast<INST_VALUES>(INST_GET(I, R_funct7)) == INST_VALUES::R_funct7_SRA)
-        result = static_cast<Word>(static_cast<SignedWord>(rs1) >> (rs2 & 0b11111));
-      else
-        throw std::runtime_error("invalid/unimplemented instruction");
-    } break;
-
-    case INST_VALUES::R_funct3_OR: {
-      // OR
-      if (static_cast<INST_VALUES>(INST_GET(I, R_funct7)) == INST_VALUES::R_funct7_OR)
-        result = rs1 | rs2;
-      else
-        throw std::runtime_error("invalid/unimplemented instruction");
-    } break;
-
-    case INST_VALUES::R_funct3_AND: {
-      // AND
-      if (static_cast<INST_VALUES>(INST_GET(I, R_funct7)) == INST_VALUES::R_funct7_AND)
-        result = rs1 & rs2;
-      else
-        throw std::runtime_error("invalid/unimplemented instruction");
-    } break;
-
-    default:
-      throw std::runtime_error("invalid/unimplemented instruction");
-    }
-
-    // standard increment as PC is unaffected
-    PC += 4;
-  } break;
-
-  case INST_VALUES::U_opcode_LUI: {
-    // LUI
-    result = imm;
-    // standard increment as PC is unaffected
-    PC += 4;
-  } break;
-
-  case INST_VALUES::B_opcode: {
-    switch (static_cast<INST_VALUES>(INST_GET(I, B_funct3))) {
-    // BEQ
-    case INST_VALUES::B_funct3_BEQ: {
-      if (rs1 == rs2)
-        PC += imm;
-      else
-        PC += 4;
-    } break;
-
-    // BNE
-    case INST_VALUES::B_funct3_BNE: {
-      if (rs1 != rs2)
-        PC += imm;
-      else
-        PC += 4;
-    } break;
-
-    // BLT
-    case INST_VALUES::B_funct3_BLT: {
-      if (static_cast<SignedWord>(rs1) < static_cast<SignedWord>(rs2))
-        PC += imm;
-      else
-        PC += 4;
-    } break;
-
-    // BGE
-    case INST_VALUES::B_funct3_BGE: {
-      if (static_cast<SignedWord>(rs1) >= static_cast<SignedWord>(rs2))
-        PC += imm;
-      else
-        PC += 4;
-    } break;
-
-    default:
-      throw std::runtime_error("invalid/unimplemented instruction");
-    }
-  } break;
-
-  case INST_VALUES::I_opcode_JALR: {
-    // JALR
-    if (static_cast<INST_VALUES>(INST_GET(I, I_funct3)) == INST_VALUES::I_funct3_JALR) {
-      result = PC + 4;
-      PC = (rs1 + imm) & ~1u;
-    } else {
-      throw std::runtime_error("invalid/unimplemented instruction");
-    }
-  } break;
-
-  case INST_VALUES::J_opcode_JAL: {
-    // JAL
-    result = PC + 4;
-    PC += imm;
-  } break;
-
-  default:
-    throw std::runtime_error("impossible situation");
-  }
-  // Execute takes 1 cycle as per project documentation
-  t += 1;
+  PC = (this->*handlers[static_cast<std::size_t>(d.op)])(d, PC, result, t);
+  memory_time = t;
+  // Decode and Execute take 1 cycle each as per project documentation, even
+  // though the actual decoding work was done once ahead of time
+  t += 2;
 
   // WRITEBACK
-  if (rd_idx != no_of_registers) {
-    RF.writeReg(rd_idx, result);
+  if (d.rd != no_of_registers) {
+    RF.writeReg(d.rd, result);
     // Writeback takes 1 cycle as per project documentation
     t += 1;
   }
 
   return {PC, t};
 }
+
+Word Simulation::execADD(const DecodedInstruction &d, Word PC, Word &result, Cycle &) {
+  result = RF.getReg(d.rs1) + RF.getReg(d.rs2);
+  // standard increment as PC is unaffected
+  return PC + 4;
+}
+
+Word Simulation::execSUB(const DecodedInstruction &d, Word PC, Word &result, Cycle &) {
+  result = RF.getReg(d.rs1) - RF.getReg(d.rs2);
+  return PC + 4;
+}
+
+Word Simulation::execSLL(const DecodedInstruction &d, Word PC, Word &result, Cycle &) {
+  result = RF.getReg(d.rs1) << (RF.getReg(d.rs2) & 0b11111);
+  return PC + 4;
+}
+
+Word Simulation::execSLT(const DecodedInstruction &d, Word PC, Word &result, Cycle &) {
+  result = static_cast<SignedWord>(RF.getReg(d.rs1)) < static_cast<SignedWord>(RF.getReg(d.rs2));
+  return PC + 4;
+}
+
+Word Simulation::execSLTU(const DecodedInstruction &d, Word PC, Word &result, Cycle &) {
+  result = RF.getReg(d.rs1) < RF.getReg(d.rs2);
+  return PC + 4;
+}
+
+Word Simulation::execXOR(const DecodedInstruction &d, Word PC, Word &result, Cycle &) {
+  result = RF.getReg(d.rs1) ^ RF.getReg(d.rs2);
+  return PC + 4;
+}
+
+Word Simulation::execSRL(const DecodedInstruction &d, Word PC, Word &result, Cycle &) {
+  result = RF.getReg(d.rs1) >> (RF.getReg(d.rs2) & 0b11111);
+  return PC + 4;
+}
+
+Word Simulation::execSRA(const DecodedInstruction &d, Word PC, Word &result, Cycle &) {
+  result = static_cast<Word>(static_cast<SignedWord>(RF.getReg(d.rs1)) >>
+                             (RF.getReg(d.rs2) & 0b11111));
+  return PC + 4;
+}
+
+Word Simulation::execOR(const DecodedInstruction &d, Word PC, Word &result, Cycle &) {
+  result = RF.getReg(d.rs1) | RF.getReg(d.rs2);
+  return PC + 4;
+}
+
+Word Simulation::execAND(const DecodedInstruction &d, Word PC, Word &result, Cycle &) {
+  result = RF.getReg(d.rs1) & RF.getReg(d.rs2);
+  return PC + 4;
+}
+
+Word Simulation::execMUL(const DecodedInstruction &d, Word PC, Word &result, Cycle &) {
+  result = RF.getReg(d.rs1) * RF.getReg(d.rs2);
+  return PC + 4;
+}
+
+Word Simulation::execMULH(const DecodedInstruction &d, Word PC, Word &result, Cycle &) {
+  // upper halves of the 64 bit products
+  result = static_cast<std::int64_t>(static_cast<SignedWord>(RF.getReg(d.rs1))) *
+               static_cast<SignedWord>(RF.getReg(d.rs2)) >>
+           XLEN;
+  return PC + 4;
+}
+
+Word Simulation::execMULHSU(const DecodedInstruction &d, Word PC, Word &result, Cycle &) {
+  result = static_cast<std::int64_t>(static_cast<SignedWord>(RF.getReg(d.rs1))) *
+               static_cast<std::int64_t>(RF.getReg(d.rs2)) >>
+           XLEN;
+  return PC + 4;
+}
+
+Word Simulation::execMULHU(const DecodedInstruction &d, Word PC, Word &result, Cycle &) {
+  result = static_cast<std::uint64_t>(RF.getReg(d.rs1)) * RF.getReg(d.rs2) >> XLEN;
+  return PC + 4;
+}
+
+// Division never traps: dividing by zero gives all ones (and leaves the
+// dividend as remainder), and the one signed overflow gives the dividend.
+
+Word Simulation::execDIV(const DecodedInstruction &d, Word PC, Word &result, Cycle &) {
+  const SignedWord a = RF.getReg(d.rs1), b = RF.getReg(d.rs2);
+  if (b == 0)
+    result = ~Word(0);
+  else if (b == -1)
+    result = 0 - static_cast<Word>(a);
+  else
+    result = a / b;
+  return PC + 4;
+}
+
+Word Simulation::execDIVU(const DecodedInstruction &d, Word PC, Word &result, Cycle &) {
+  const Word a = RF.getReg(d.rs1), b = RF.getReg(d.rs2);
+  result = b == 0 ? ~Word(0) : a / b;
+  return PC + 4;
+}
+
+Word Simulation::execREM(const DecodedInstruction &d, Word PC, Word &result, Cycle &) {
+  const SignedWord a = RF.getReg(d.rs1), b = RF.getReg(d.rs2);
+  if (b == 0)
+    result = a;
+  else if (b == -1)
+    result = 0;
+  else
+    result = a % b;
+  return PC + 4;
+}
+
+Word Simulation::execREMU(const DecodedInstruction &d, Word PC, Word &result, Cycle &) {
+  const Word a = RF.getReg(d.rs1), b = RF.getReg(d.rs2);
+  result = b == 0 ? a : a % b;
+  return PC + 4;
+}
+
+Word Simulation::execADDI(const DecodedInstruction &d, Word PC, Word &result, Cycle &) {
+  result = RF.getReg(d.rs1) + d.imm;
+  return PC + 4;
+}
+
+Word Simulation::execSLTI(const DecodedInstruction &d, Word PC, Word &result, Cycle &) {
+  result = static_cast<SignedWord>(RF.getReg(d.rs1)) < static_cast<SignedWord>(d.imm);
+  return PC + 4;
+}
+
+Word Simulation::execSLTIU(const DecodedInstruction &d, Word PC, Word &result, Cycle &) {
+  // the immediate is sign-extended, then compared unsigned
+  result = RF.getReg(d.rs1) < d.imm;
+  return PC + 4;
+}
+
+Word Simulation::execXORI(const DecodedInstruction &d, Word PC, Word &result, Cycle &) {
+  result = RF.getReg(d.rs1) ^ d.imm;
+  return PC + 4;
+}
+
+Word Simulation::execORI(const DecodedInstruction &d, Word PC, Word &result, Cycle &) {
+  result = RF.getReg(d.rs1) | d.imm;
+  return PC + 4;
+}
+
+Word Simulation::execANDI(const DecodedInstruction &d, Word PC, Word &result, Cycle &) {
+  result = RF.getReg(d.rs1) & d.imm;
+  return PC + 4;
+}
+
+Word Simulation::execSLLI(const DecodedInstruction &d, Word PC, Word &result, Cycle &) {
+  // the shift amount is the low 5 bits of the immediate
+  result = RF.getReg(d.rs1) << (d.imm & 0b11111);
+  return PC + 4;
+}
+
+Word Simulation::execSRLI(const DecodedInstruction &d, Word PC, Word &result, Cycle &) {
+  result = RF.getReg(d.rs1) >> (d.imm & 0b11111);
+  return PC + 4;
+}
+
+Word Simulation::execSRAI(const DecodedInstruction &d, Word PC, Word &result, Cycle &) {
+  result = static_cast<Word>(static_cast<SignedWord>(RF.getReg(d.rs1)) >> (d.imm & 0b11111));
+  return PC + 4;
+}
+
+Word Simulation::load(const Word address, const Word bytes, const Word PC, Cycle &t) {
+  if (address & (bytes - 1))
+    throw std::runtime_error("unaligned memory access");
+  // bytes and halfwords are read as the word holding them
+  auto [word, t_] = memory.getData(address & ~3u, PC);
+  t += t_;
+  if (bytes == 4)
+    return word;
+  return word >> (address & 3) * 8 & ((1u << bytes * 8) - 1);
+}
+
+void Simulation::store(const Word address, const Word val, const Word bytes, const Word PC,
+                       Cycle &t) {
+  if (address & (bytes - 1))
+    throw std::runtime_error("unaligned memory access");
+  if (bytes == 4) {
+    t += memory.writeData(address, val, PC);
+    return;
+  }
+  const Word shift = (address & 3) * 8;
+  t += memory.writeMasked(address & ~3u, val << shift, ((1u << bytes * 8) - 1) << shift, PC);
+}
+
+Word Simulation::execLB(const DecodedInstruction &d, Word PC, Word &result, Cycle &t) {
+  result = static_cast<SignedWord>(static_cast<std::int8_t>(
+      load(RF.getReg(d.rs1) + d.imm, 1, PC, t)));
+  return PC + 4;
+}
+
+Word Simulation::execLH(const DecodedInstruction &d, Word PC, Word &result, Cycle &t) {
+  result = static_cast<SignedWord>(static_cast<std::int16_t>(
+      load(RF.getReg(d.rs1) + d.imm, 2, PC, t)));
+  return PC + 4;
+}
+
+Word Simulation::execLW(const DecodedInstruction &d, Word PC, Word &result, Cycle &t) {
+  result = load(RF.getReg(d.rs1) + d.imm, 4, PC, t);
+  return PC + 4;
+}
+
+Word Simulation::execLBU(const DecodedInstruction &d, Word PC, Word &result, Cycle &t) {
+  result = load(RF.getReg(d.rs1) + d.imm, 1, PC, t);
+  return PC + 4;
+}
+
+Word Simulation::execLHU(const DecodedInstruction &d, Word PC, Word &result, Cycle &t) {
+  result = load(RF.getReg(d.rs1) + d.imm, 2, PC, t);
+  return PC + 4;
+}
+
+Word Simulation::execJALR(const DecodedInstruction &d, Word PC, Word &result, Cycle &) {
+  result = PC + 4;
+  return (RF.getReg(d.rs1) + d.imm) & ~1u;
+}
+
+Word Simulation::execFENCE(const DecodedInstruction &, Word PC, Word &, Cycle &) {
+  // there is nothing to order, a single hart sees its accesses in order
+  return PC + 4;
+}
+
+Word Simulation::execECALL(const DecodedInstruction &, Word, Word &, Cycle &) {
+  throw std::runtime_error("ecall: there is no execution environment to call");
+}
+
+Word Simulation::execEBREAK(const DecodedInstruction &, Word, Word &, Cycle &) {
+  throw std::runtime_error("ebreak: there is no debugger to break into");
+}
+
+Word Simulation::execSB(const DecodedInstruction &d, Word PC, Word &, Cycle &t) {
+  store(RF.getReg(d.rs1) + d.imm, RF.getReg(d.rs2), 1, PC, t);
+  return PC + 4;
+}
+
+Word Simulation::execSH(const DecodedInstruction &d, Word PC, Word &, Cycle &t) {
+  store(RF.getReg(d.rs1) + d.imm, RF.getReg(d.rs2), 2, PC, t);
+  return PC + 4;
+}
+
+Word Simulation::execSW(const DecodedInstruction &d, Word PC, Word &, Cycle &t) {
+  store(RF.getReg(d.rs1) + d.imm, RF.getReg(d.rs2), 4, PC, t);
+  return PC + 4;
+}
+
+Word Simulation::execBEQ(const DecodedInstruction &d, Word PC, Word &, Cycle &) {
+  return RF.getReg(d.rs1) == RF.getReg(d.rs2) ? PC + d.imm : PC + 4;
+}
+
+Word Simulation::execBNE(const DecodedInstruction &d, Word PC, Word &, Cycle &) {
+  return RF.getReg(d.rs1) != RF.getReg(d.rs2) ? PC + d.imm : PC + 4;
+}
+
+Word Simulation::execBLT(const DecodedInstruction &d, Word PC, Word &, Cycle &) {
+  return static_cast<SignedWord>(RF.getReg(d.rs1)) < static_cast<SignedWord>(RF.getReg(d.rs2))
+             ? PC + d.imm
+             : PC + 4;
+}
+
+Word Simulation::execBGE(const DecodedInstruction &d, Word PC, Word &, Cycle &) {
+  return static_cast<SignedWord>(RF.getReg(d.rs1)) >= static_cast<SignedWord>(RF.getReg(d.rs2))
+             ? PC + d.imm
+             : PC + 4;
+}
+
+Word Simulation::execBLTU(const DecodedInstruction &d, Word PC, Word &, Cycle &) {
+  return RF.getReg(d.rs1) < RF.getReg(d.rs2) ? PC + d.imm : PC + 4;
+}
+
+Word Simulation::execBGEU(const DecodedInstruction &d, Word PC, Word &, Cycle &) {
+  return RF.getReg(d.rs1) >= RF.getReg(d.rs2) ? PC + d.imm : PC + 4;
+}
+
+Word Simulation::execLUI(const DecodedInstruction &d, Word PC, Word &result, Cycle &) {
+  result = d.imm;
+  return PC + 4;
+}
+
+Word Simulation::execAUIPC(const DecodedInstruction &d, Word PC, Word &result, Cycle &) {
+  result = PC + d.imm;
+  return PC + 4;
+}
+
+Word Simulation::execJAL(const DecodedInstruction &d, Word PC, Word &result, Cycle &) {
+  result = PC + 4;
+  return PC + d.imm;
+}
+
+Word Simulation::execInvalidOpcode(const DecodedInstruction &, Word, Word &, Cycle &) {
+  throw std::runtime_error("invalid/unimplemented opcode");
+}
+
+Word Simulation::execInvalidInstruction(const DecodedInstruction &, Word, Word &, Cycle &) {
+  throw std::runtime_error("invalid/unimplemented instruction");
+}
@@ -1,9 +1,46 @@
 #ifndef __SIMULATION_H
 #define __SIMULATION_H
 
+#include "Decoder.hpp"
+#include "EventCore.hpp"
+#include "Loader.hpp"
 #include "Memory.hpp"
+#include "Pipeline.hpp"
+#include "Profiler.hpp"
 #include "RegisterFile.hpp"
+#include "Sampling.hpp"
+#include "Trace.hpp"
+#include <array>  // for std::array
+#include <memory> // for std::unique_ptr
+#include <optional> // for std::optional
 #include <string>
+#include <unordered_map> // for std::unordered_map
+#include <vector> // for std::vector
+
+// execution engines, the interpreter is the reference the others are diffed against
+enum class Engine { Interpreter, BasicBlock };
+
+struct SimulationConfig {
+  Engine engine = Engine::Interpreter;
+  TraceLevel trace_level = TraceLevel::Full;
+  // if set, per-instruction trace records go to this file in binary form
+  std::string trace_path;
+  ProgramFormat format = ProgramFormat::Auto;
+  // where Raw images are loaded and start executing
+  Word load_address = 0;
+  Timing timing = Timing::Serial;
+  // only used with Timing::Pipeline, except that its flush cycles and
+  // predictor also apply to Timing::Event
+  PipelineConfig pipeline;
+  // only used with Timing::Event
+  EventCoreConfig event_core;
+  // per-PC profiling, with labels from the symbol file if one is given
+  bool profile = false;
+  std::string symbols_path;
+  // sinks for the trace and summary, and for warnings; every simulation can
+  // have its own
+  std::ostream *output = &std::cout, *diagnostics = &std::cerr;
+};
 
 class Simulation final {
 
@@ -11,19 +48,231 @@ class Simulation final {
   RegisterFile RF;
 
   const std::string binary_path;
+  const ProgramFormat format;
+  const Word load_address;
+  const Engine engine;
+  std::ostream &output, &diagnostics;
+  Tracer tracer;
+  // set if instructions are timed by the pipeline model
+  std::optional<Pipeline> pipeline;
+  // set if instructions are timed by the event core
+  std::optional<EventCore> event_core;
+  std::optional<Profiler> profiler;
+  // cache misses up to the last profiled instruction
+  std::uint64_t misses_seen = 0;
+  // instructions timed so far, fast-forwarded ones are not counted
+  std::uint64_t instructions = 0;
+
+  // decoded records of the program, indexed by the word offset of the PC
+  // into program memory and filled lazily on
+  // first fetch; a record is re-decoded if the fetched word no longer matches
+  std::vector<DecodedInstruction> decoded;
+  // record for an instruction fetched from outside program memory
+  DecodedInstruction uncached;
+
+  // an operation handler executes an already decoded instruction, it returns
+  // the next PC and sets the value to be written back to rd (if any)
+  using Handler = Word (Simulation::*)(const DecodedInstruction &, Word PC, Word &result, Cycle &t);
+
+  static const std::array<Handler, static_cast<std::size_t>(Operation::COUNT)> handlers;
+
+  // A straight-line run of instructions ending at a branch or jump, translated
+  // once and then executed without per-instruction lookups. Blocks link to the
+  // blocks that followed them so that hot paths skip the block map entirely.
+  struct Block {
+    Word start = 0;
+    std::vector<DecodedInstruction> insts;
+    // set when a fetched word no longer matches its record
+    bool stale = false;
+    // successors seen so far, keyed by their start address
+    Block *fallthrough = nullptr, *taken = nullptr;
+  };
+
+  std::unordered_map<Word, std::unique_ptr<Block>> blocks;
+  // blocks translated from each code page of program memory, marked stale
+  // when a store hits the page
+  std::vector<std::vector<Block *>> page_blocks;
+
+  // program memory range, blocks are only translated inside it
+  Word program_begin = 0, program_end = 0;
+
+  // state of the stepping interface
+  Word PC = 0, end_PC = 0;
+  Cycle elapsed = 0;
+
+  Program initialize();
+  void setup(const Program &program);
+
+  void tracePC(const Word PC) { tracer.instructionBegin(PC); }
+  void traceRetire(const Word PC, const DecodedInstruction &d, const Cycle t) {
+    tracer.instructionEnd(PC, t, RF, d.rd);
+  }
 
-  Word initialize();
+  // cycles of the memory access of the instruction executed last, 0 if it
+  // made none
+  Cycle memory_time = 0;
 
-  std::pair<Word, Cycle> execute(const Instruction, Word);
+  // cycles the timing model charges to an executed instruction
+  Cycle charge(const DecodedInstruction &d, const Word PC, const Word next_PC,
+               const Cycle t_fetch, const Cycle t_execute) {
+    const Cycle t = pipeline     ? pipeline->retire(d, PC, next_PC, t_fetch, memory_time)
+                    : event_core ? event_core->retire(d, PC, next_PC, t_fetch, memory_time)
+                                 : t_fetch + t_execute;
+    ++instructions;
+    if (profiler)
+      profile(d, PC, t, t_fetch, t_execute);
+    return t;
+  }
+
+  void profile(const DecodedInstruction &d, const Word PC, const Cycle t, const Cycle t_fetch,
+               const Cycle t_execute);
+
+  Cycle interpret(Word PC, const Word end);
+
+  // sampled runs, live in Sampling.cpp; both run at most n instructions from
+  // the PC and return how many ran
+  std::uint64_t fastForward(const std::uint64_t n);
+  std::uint64_t runTimed(const std::uint64_t n, Cycle &time);
+
+  // block engine, lives in BlockEngine.cpp
+  Cycle runBlocks(Word PC, const Word end);
+  Block *getBlock(const Word PC);
+  void translate(Block &);
+  void invalidateBlocks(const Word begin, const Word end);
+  Word executeBlock(Block &, Cycle &time);
+  Word executePlainBlock(Block &, Cycle &time);
+
+  const DecodedInstruction &getDecoded(const Word PC, const Instruction);
+
+  // loads and stores of 1, 2 or 4 bytes, which must be aligned to their size;
+  // loaded values are zero-extended
+  Word load(const Word address, const Word bytes, const Word PC, Cycle &t);
+  void store(const Word address, const Word val, const Word bytes, const Word PC, Cycle &t);
+
+  std::pair<Word, Cycle> execute(const DecodedInstruction &, Word);
+
+  // R-type
+  Word execADD(const DecodedInstruction &, Word, Word &, Cycle &);
+  Word execSUB(const DecodedInstruction &, Word, Word &, Cycle &);
+  Word execSLL(const DecodedInstruction &, Word, Word &, Cycle &);
+  Word execSLT(const DecodedInstruction &, Word, Word &, Cycle &);
+  Word execSLTU(const DecodedInstruction &, Word, Word &, Cycle &);
+  Word execXOR(const DecodedInstruction &, Word, Word &, Cycle &);
+  Word execSRL(const DecodedInstruction &, Word, Word &, Cycle &);
+  Word execSRA(const DecodedInstruction &, Word, Word &, Cycle &);
+  Word execOR(const DecodedInstruction &, Word, Word &, Cycle &);
+  Word execAND(const DecodedInstruction &, Word, Word &, Cycle &);
+  // R-type, M extension
+  Word execMUL(const DecodedInstruction &, Word, Word &, Cycle &);
+  Word execMULH(const DecodedInstruction &, Word, Word &, Cycle &);
+  Word execMULHSU(const DecodedInstruction &, Word, Word &, Cycle &);
+  Word execMULHU(const DecodedInstruction &, Word, Word &, Cycle &);
+  Word execDIV(const DecodedInstruction &, Word, Word &, Cycle &);
+  Word execDIVU(const DecodedInstruction &, Word, Word &, Cycle &);
+  Word execREM(const DecodedInstruction &, Word, Word &, Cycle &);
+  Word execREMU(const DecodedInstruction &, Word, Word &, Cycle &);
+  // I-type
+  Word execADDI(const DecodedInstruction &, Word, Word &, Cycle &);
+  Word execSLTI(const DecodedInstruction &, Word, Word &, Cycle &);
+  Word execSLTIU(const DecodedInstruction &, Word, Word &, Cycle &);
+  Word execXORI(const DecodedInstruction &, Word, Word &, Cycle &);
+  Word execORI(const DecodedInstruction &, Word, Word &, Cycle &);
+  Word execANDI(const DecodedInstruction &, Word, Word &, Cycle &);
+  Word execSLLI(const DecodedInstruction &, Word, Word &, Cycle &);
+  Word execSRLI(const DecodedInstruction &, Word, Word &, Cycle &);
+  Word execSRAI(const DecodedInstruction &, Word, Word &, Cycle &);
+  Word execLB(const DecodedInstruction &, Word, Word &, Cycle &);
+  Word execLH(const DecodedInstruction &, Word, Word &, Cycle &);
+  Word execLW(const DecodedInstruction &, Word, Word &, Cycle &);
+  Word execLBU(const DecodedInstruction &, Word, Word &, Cycle &);
+  Word execLHU(const DecodedInstruction &, Word, Word &, Cycle &);
+  Word execJALR(const DecodedInstruction &, Word, Word &, Cycle &);
+  Word execFENCE(const DecodedInstruction &, Word, Word &, Cycle &);
+  Word execECALL(const DecodedInstruction &, Word, Word &, Cycle &);
+  Word execEBREAK(const DecodedInstruction &, Word, Word &, Cycle &);
+  // S-type
+  Word execSB(const DecodedInstruction &, Word, Word &, Cycle &);
+  Word execSH(const DecodedInstruction &, Word, Word &, Cycle &);
+  Word execSW(const DecodedInstruction &, Word, Word &, Cycle &);
+  // B-type
+  Word execBEQ(const DecodedInstruction &, Word, Word &, Cycle &);
+  Word execBNE(const DecodedInstruction &, Word, Word &, Cycle &);
+  Word execBLT(const DecodedInstruction &, Word, Word &, Cycle &);
+  Word execBGE(const DecodedInstruction &, Word, Word &, Cycle &);
+  Word execBLTU(const DecodedInstruction &, Word, Word &, Cycle &);
+  Word execBGEU(const DecodedInstruction &, Word, Word &, Cycle &);
+  // U-type
+  Word execLUI(const DecodedInstruction &, Word, Word &, Cycle &);
+  Word execAUIPC(const DecodedInstruction &, Word, Word &, Cycle &);
+  // J-type
+  Word execJAL(const DecodedInstruction &, Word, Word &, Cycle &);
+  // decoding failures
+  Word execInvalidOpcode(const DecodedInstruction &, Word, Word &, Cycle &);
+  Word execInvalidInstruction(const DecodedInstruction &, Word, Word &, Cycle &);
 
 public:
-  Simulation(const Memory &memory_, const std::string binary_path_)
-      : memory(memory_), RF(), binary_path(binary_path_) {
+  Simulation(const Memory &memory_, const std::string binary_path_,
+             const SimulationConfig &config = {})
+      : memory(memory_), RF(), binary_path(binary_path_), format(config.format),
+        load_address(config.load_address), engine(config.engine), output(*config.output),
+        diagnostics(*config.diagnostics), tracer(config.trace_level, output, config.trace_path) {
     static_assert(XLEN == ILEN,
-                  "This simulator only works for RISCV RV32I base ISA.");
+                  "This simulator only works for the RISCV RV32IM ISA.");
+    memory.setDiagnostics(diagnostics);
+    if (config.timing == Timing::Pipeline)
+      pipeline.emplace(config.pipeline);
+    if (config.timing == Timing::Event)
+      event_core.emplace(config.event_core, config.pipeline);
+    if (config.profile)
+      profiler.emplace(config.symbols_path.empty() ? Symbols() : Symbols(config.symbols_path));
   }
 
-  void simulate();
+  // runs the program to its end, returning the cycles it took
+  Cycle simulate();
+
+  // runs from where the stepping interface (or a restored checkpoint) left
+  // off to the end of the program with the configured engine, returning the
+  // total cycles
+  Cycle resume();
+
+  // Runs from where the stepping interface (or a restored checkpoint) left off
+  // to the end of the program, timing only the warm-up and detail windows
+  // laid out by config and executing everything else functionally. The
+  // estimate is printed along with the summary. It always uses the
+  // interpreter.
+  SamplingResult sample(const SamplingConfig &config);
+
+  // Checkpoints of the PC, registers, main memory, caches and timing model,
+  // for resuming a run, possibly with other cache timing, without executing
+  // its beginning again; they live in Checkpoint.cpp. Restoring replaces
+  // start.
+  void saveCheckpoint(std::ostream &os);
+  void restoreCheckpoint(std::istream &is);
+
+  // Stepping interface, for driving the simulation from outside (e.g. as one
+  // hart of a MultiHart); it always uses the interpreter. start loads the
+  // program, or takes one already loaded into main memory.
+  Program start();
+  void start(const Program &program);
+  bool finished() const { return PC == end_PC; }
+  // executes one instruction, returning the cycles it took
+  Cycle step();
+  // steps until the PC is stop_PC, the program ends or at least max_cycles
+  // have passed, returning the cycles run; nothing runs if the PC already is
+  // stop_PC
+  Cycle runUntil(const Word stop_PC, const Cycle max_cycles = ~Cycle(0));
+  Word getPC() const { return PC; }
+  // cycles run through the stepping interface so far
+  Cycle getCycles() const { return elapsed; }
+  std::uint64_t getInstructions() const { return instructions; }
+  RegisterFile &registers() { return RF; }
+  Memory &getMemory() { return memory; }
+  // nullptr unless timed by the pipeline model
+  const Pipeline *getPipeline() const { return pipeline ? &*pipeline : nullptr; }
+  // nullptr unless timed by the event core
+  const EventCore *getEventCore() const { return event_core ? &*event_core : nullptr; }
+  // nullptr unless profiling
+  const Profiler *getProfiler() const { return profiler ? &*profiler : nullptr; }
 };
 
 #endif /* end of __SIMULATION_H */
@@ -0,0 +1,154 @@
+#include "StackDistance.hpp"
+#include <iomanip>       // for std::setw
+#include <map>           // for std::map
+#include <numeric>       // for std::partial_sum
+#include <sstream>       // for formatting miss rates
+#include <unordered_map> // for std::unordered_map
+
+MissCurveConfig parseMissCurveConfig(const std::string &grid) {
+  MissCurveConfig config;
+  for (const auto &[key, values] : parseGridAxes(grid)) {
+    if (key == "block") {
+      config.block_sizes.clear();
+      for (const std::string &value : values)
+        config.block_sizes.push_back(std::stoul(value, nullptr, 0));
+    } else if (key == "assoc") {
+      config.associativities.clear();
+      for (const std::string &value : values)
+        config.associativities.push_back(value == "full" ? 0 : std::stoul(value, nullptr, 0));
+    } else if (key == "max" and values.size() == 1) {
+      config.max_size = std::stoul(values[0], nullptr, 0);
+    } else {
+      throw std::runtime_error("unknown miss curve setting '" + key + "'");
+    }
+  }
+  // the curves are made of power of 2 caches, fully associative ones aside
+  auto powerOf2 = [](const Word x) { return x != 0 and (x & (x - 1)) == 0; };
+  for (const Word block_size : config.block_sizes)
+    if (not powerOf2(block_size) or config.max_size < block_size)
+      throw std::runtime_error("miss curve block sizes must be powers of 2 no larger than max");
+  for (const Word associativity : config.associativities)
+    if (associativity != 0 and not powerOf2(associativity))
+      throw std::runtime_error("miss curve associativities must be powers of 2 or full");
+  return config;
+}
+
+namespace {
+
+// Stack distances seen in one pass. Distances of cap or more are counted
+// together in the last bucket.
+struct DistanceHistogram {
+  std::vector<std::uint64_t> counts;
+  // first touches of a block, which miss at every size
+  std::uint64_t cold = 0;
+
+  std::uint64_t misses(const Word associativity) const {
+    std::uint64_t result = cold;
+    for (std::size_t d = associativity; d < counts.size(); ++d)
+      result += counts[d];
+    return result;
+  }
+};
+
+// Fenwick tree over the n access times of one set, in place in tree.
+// prefix(i) is the sum of the values at times [0, i).
+std::uint32_t prefix(const std::uint32_t *tree, std::size_t i) {
+  std::uint32_t sum = 0;
+  for (; i > 0; i &= i - 1)
+    sum += tree[i - 1];
+  return sum;
+}
+
+void add(std::uint32_t *tree, const std::size_t n, std::size_t i, const std::uint32_t delta) {
+  for (++i; i <= n; i += i & -i)
+    tree[i - 1] += delta;
+}
+
+// One pass over the trace for caches of the given block size and sets. Every
+// block's latest access time in its set holds a 1, so the distinct blocks
+// touched since the previous access to a block are a range sum.
+DistanceHistogram measure(const std::vector<Access> &accesses, const Word block_size,
+                          const Word sets, const Word cap) {
+  const AddressMap map(block_size, sets);
+
+  // each set gets a tree as long as its number of accesses
+  std::vector<std::size_t> base(sets + 1, 0);
+  for (const Access &access : accesses)
+    ++base[map.getIndex(access.address) + 1];
+  std::partial_sum(base.begin(), base.end(), base.begin());
+  std::vector<std::uint32_t> trees(accesses.size(), 0);
+  std::vector<std::size_t> now(sets, 0);
+
+  std::unordered_map<Word, std::size_t> last;
+  DistanceHistogram histogram;
+  histogram.counts.assign(cap + 1, 0);
+  for (const Access &access : accesses) {
+    const Word index = map.getIndex(access.address);
+    const Word block = map.getAddress(map.getTag(access.address), index, 0);
+    std::uint32_t *tree = &trees[base[index]];
+    const std::size_t n = base[index + 1] - base[index];
+    const std::size_t time = now[index]++;
+
+    auto [it, first_touch] = last.try_emplace(block, time);
+    if (first_touch) {
+      ++histogram.cold;
+    } else {
+      const std::size_t previous = it->second;
+      const std::size_t distance = prefix(tree, time) - prefix(tree, previous + 1);
+      ++histogram.counts[std::min<std::size_t>(distance, cap)];
+      add(tree, n, previous, -1);
+      it->second = time;
+    }
+    add(tree, n, time, 1);
+  }
+  return histogram;
+}
+
+} // namespace
+
+std::vector<MissCurvePoint> computeMissCurves(const AccessTrace &trace,
+                                              const MissCurveConfig &config) {
+  const auto &accesses = trace.getAccesses();
+  std::vector<MissCurvePoint> points;
+  for (const Word block_size : config.block_sizes) {
+    // passes made so far for this block size, by number of sets
+    std::map<Word, DistanceHistogram> passes;
+    auto histogram = [&](const Word sets) -> const DistanceHistogram & {
+      auto it = passes.find(sets);
+      if (it == passes.end())
+        it = passes.emplace(sets, measure(accesses, block_size, sets,
+                                          config.max_size / block_size / sets))
+                 .first;
+      return it->second;
+    };
+
+    for (const Word associativity : config.associativities) {
+      if (associativity == 0) {
+        // fully associative, a single set of every power of 2 number of lines
+        for (Word lines = 1; lines * block_size <= config.max_size; lines *= 2)
+          points.push_back({block_size, 0, lines * block_size, accesses.size(),
+                            histogram(1).misses(lines)});
+        continue;
+      }
+      for (Word sets = 1; sets * associativity * block_size <= config.max_size; sets *= 2)
+        points.push_back({block_size, associativity, sets * associativity * block_size,
+                          accesses.size(), histogram(sets).misses(associativity)});
+    }
+  }
+  return points;
+}
+
+void printMissCurves(std::ostream &os, const std::vector<MissCurvePoint> &points) {
+  os << std::left;
+  os << std::setw(7) << "block" << std::setw(7) << "assoc" << std::setw(10) << "size"
+     << std::setw(12) << "accesses" << std::setw(12) << "misses" << "miss rate\n";
+  for (const MissCurvePoint &p : points) {
+    std::ostringstream miss_rate;
+    miss_rate << std::fixed << std::setprecision(3)
+              << (p.accesses ? 100.0L * p.misses / p.accesses : 0.0L) << "%";
+    os << std::setw(7) << p.block_size << std::setw(7)
+       << (p.associativity ? std::to_string(p.associativity) : "full") << std::setw(10) << p.size
+       << std::setw(12) << p.accesses << std::setw(12) << p.misses << miss_rate.str() << "\n";
+  }
+  os << std::right;
+}
@@ -0,0 +1,37 @@
+#ifndef __STACK_DISTANCE_H
+#define __STACK_DISTANCE_H
+
+#include "Sweep.hpp"
+#include <vector> // for std::vector
+
+// Which LRU miss-rate curves to compute. Every block size is combined with
+// every associativity; 0 stands for fully associative.
+struct MissCurveConfig {
+  std::vector<Word> block_sizes{1, 2, 4};
+  std::vector<Word> associativities{1, 2, 4, 0};
+  // largest cache size of the curves, in terms of Word
+  Word max_size = 1024;
+};
+
+// Parses a grid such as "block=1|2,assoc=1|2|full,max=4096". Block sizes and
+// associativities must be powers of 2, and max at least every block size.
+MissCurveConfig parseMissCurveConfig(const std::string &grid);
+
+struct MissCurvePoint {
+  Word block_size, associativity, size;
+  std::uint64_t accesses, misses;
+};
+
+// Computes the misses of LRU caches of every power of 2 size up to
+// config.max_size, for each block size and associativity, from the stack
+// distances of the accesses. A cache with S sets of a given block size hits
+// exactly on the accesses whose block was touched within its set less than
+// associativity distinct blocks ago, so one pass per (block size, sets) yields
+// the misses of every associativity at once. Write policies do not change
+// which accesses hit, as every access allocates.
+std::vector<MissCurvePoint> computeMissCurves(const AccessTrace &trace,
+                                              const MissCurveConfig &config);
+
+void printMissCurves(std::ostream &os, const std::vector<MissCurvePoint> &points);
+
+#endif /* end of __STACK_DISTANCE_H */
@@ -0,0 +1,161 @@
+#include "Sweep.hpp"
+#include <atomic>   // for handing out configurations
+#include <iomanip>  // for std::setw
+#include <optional> // for std::optional
+#include <sstream>  // for formatting miss rates
+#include <thread>   // for std::thread
+
+GridAxes parseGridAxes(const std::string &grid) {
+  GridAxes axes;
+  std::size_t begin = 0;
+  while (begin < grid.size()) {
+    std::size_t end = grid.find(',', begin);
+    if (end == std::string::npos)
+      end = grid.size();
+    const std::string setting = grid.substr(begin, end - begin);
+    begin = end + 1;
+
+    const std::size_t eq = setting.find('=');
+    if (eq == std::string::npos)
+      throw std::runtime_error("grid setting '" + setting + "' is not key=value|value...");
+    std::vector<std::string> values;
+    for (std::size_t from = eq + 1;;) {
+      const std::size_t bar = setting.find('|', from);
+      values.push_back(setting.substr(from, bar == std::string::npos ? bar : bar - from));
+      if (bar == std::string::npos)
+        break;
+      from = bar + 1;
+    }
+    axes.emplace_back(setting.substr(0, eq), values);
+  }
+  return axes;
+}
+
+std::vector<CacheConfig> parseSweepGrid(const std::string &grid) {
+  const GridAxes axes = parseGridAxes(grid);
+
+  // walk the cartesian product like an odometer
+  std::vector<CacheConfig> configs;
+  std::vector<std::size_t> choice(axes.size(), 0);
+  for (;;) {
+    std::string spec;
+    for (std::size_t i = 0; i < axes.size(); ++i)
+      spec += (i ? "," : "") + axes[i].first + "=" + axes[i].second[choice[i]];
+    // invalid combinations are only left out once replayed
+    configs.push_back(parseCacheSettings(spec));
+
+    std::size_t i = 0;
+    for (; i < axes.size(); ++i) {
+      if (++choice[i] < axes[i].second.size())
+        break;
+      choice[i] = 0;
+    }
+    if (i == axes.size())
+      break;
+  }
+  return configs;
+}
+
+Cycle replayAccesses(const std::vector<Access> &accesses, Memory &memory) {
+  Cycle t = 0;
+  for (const Access &access : accesses) {
+    switch (access.kind) {
+    case AccessKind::Fetch:
+      t += memory.fetchInstruction(access.address).second;
+      break;
+    case AccessKind::Load:
+      t += memory.getData(access.address).second;
+      break;
+    case AccessKind::Store:
+      t += memory.writeData(access.address, access.value);
+      break;
+    }
+  }
+  return t;
+}
+
+namespace {
+
+std::optional<SweepResult> replayConfig(const AccessTrace &trace, const Cycle base_cycles,
+                                        const CacheConfig &config) {
+  std::unique_ptr<Cache> cache;
+  try {
+    checkCacheConfig(config);
+    cache = makeCache(config);
+  } catch (std::exception &) {
+    return std::nullopt;
+  }
+  // the whole address space, pages are only allocated where the trace writes
+  MainMemory mainMemory{100, 1u << (XLEN - 2)};
+  Memory memory{&mainMemory, cache.get()};
+  // the program is long gone, stores to its memory are not worth tracking
+  memory.set_program_memory(0, 0);
+
+  SweepResult result;
+  result.config = config;
+  result.total_cycles = base_cycles + replayAccesses(trace.getAccesses(), memory);
+  result.accesses = trace.getAccesses().size();
+  result.hits = cache->getStats().hits;
+  result.misses = cache->getStats().misses;
+  return result;
+}
+
+} // namespace
+
+std::vector<SweepResult> runSweep(const AccessTrace &trace, const Cycle base_cycles,
+                                  const std::vector<CacheConfig> &configs, unsigned threads) {
+  if (threads == 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+
+  // every configuration is independent, so workers just take the next one
+  std::vector<std::optional<SweepResult>> slots(configs.size());
+  std::atomic<std::size_t> next{0};
+  auto worker = [&]() {
+    for (std::size_t i; (i = next.fetch_add(1)) < configs.size();)
+      slots[i] = replayConfig(trace, base_cycles, configs[i]);
+  };
+  std::vector<std::thread> pool;
+  for (unsigned i = 1; i < threads; ++i)
+    pool.emplace_back(worker);
+  worker();
+  for (auto &thread : pool)
+    thread.join();
+
+  std::vector<SweepResult> results;
+  for (auto &slot : slots)
+    if (slot)
+      results.push_back(*slot);
+  return results;
+}
+
+void printSweep(std::ostream &os, const std::vector<SweepResult> &results) {
+  auto writePolicy = [](WritePolicy WP) { return WP == WritePolicy::WriteBack ? "wb" : "wt"; };
+  auto replacementPolicy = [](ReplacementPolicy RP) {
+    switch (RP) {
+    case ReplacementPolicy::LRU:
+      return "lru";
+    case ReplacementPolicy::FIFO:
+      return "fifo";
+    default:
+      return "random";
+    }
+  };
+
+  os << std::left;
+  os << std::setw(8) << "size" << std::setw(7) << "block" << std::setw(7) << "assoc"
+     << std::setw(7) << "write" << std::setw(7) << "repl" << std::setw(5) << "hit"
+     << std::setw(6) << "miss" << std::setw(12) << "accesses" << std::setw(12) << "misses"
+     << std::setw(12) << "miss rate" << "total cycles\n";
+  for (const SweepResult &r : results) {
+    std::ostringstream miss_rate;
+    miss_rate << std::fixed << std::setprecision(3)
+              << (r.accesses ? 100.0L * r.misses / r.accesses : 0.0L) << "%";
+    os << std::setw(8) << r.config.size << std::setw(7) << r.config.block_size << std::setw(7)
+       << r.config.associativity << std::setw(7) << writePolicy(r.config.WP) << std::setw(7)
+       << replacementPolicy(r.config.RP) << std::setw(5) << r.config.hit_time << std::setw(6)
+       << r.config.miss_penalty << std::setw(12) << r.accesses << std::setw(12) << r.misses
+       << std::setw(12) << miss_rate.str() << r.total_cycles
+       << "\n";
+  }
+  os << std::right;
+}
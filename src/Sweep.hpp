@@ -0,0 +1,40 @@
+#ifndef __SWEEP_H
+#define __SWEEP_H
+
+#include "Memory.hpp"
+#include <string>
+#include <vector> // for std::vector
+
+struct SweepResult {
+  CacheConfig config;
+  std::uint64_t accesses = 0, hits = 0, misses = 0;
+  // base cycles of the recorded run plus the replayed memory cycles
+  Cycle total_cycles = 0;
+};
+
+// Settings of a grid with their alternatives, in the order given.
+using GridAxes = std::vector<std::pair<std::string, std::vector<std::string>>>;
+
+// Splits "key=value|value...,key=value..." into its settings.
+GridAxes parseGridAxes(const std::string &grid);
+
+// Expands a grid such as "size=16|32|64,assoc=1|2,write=wt|wb" into every
+// combination of the listed values, using the cache spec keys of
+// parseCacheConfig; unlisted settings keep their defaults. Combinations are
+// not checked, see runSweep.
+std::vector<CacheConfig> parseSweepGrid(const std::string &grid);
+
+// Feeds the accesses to the memory subsystem as the program made them,
+// returning the cycles they took.
+Cycle replayAccesses(const std::vector<Access> &accesses, Memory &memory);
+
+// Replays the trace against a single cache of every configuration, spread
+// over threads (0 means one per hardware thread). Configurations that do not
+// describe a valid cache are left out of the result. base_cycles are the
+// cycles of the recorded run not spent in the memory subsystem.
+std::vector<SweepResult> runSweep(const AccessTrace &trace, const Cycle base_cycles,
+                                  const std::vector<CacheConfig> &configs, unsigned threads = 0);
+
+void printSweep(std::ostream &os, const std::vector<SweepResult> &results);
+
+#endif /* end of __SWEEP_H */
@@ -0,0 +1,108 @@
+#include "Trace.hpp"
+#include <algorithm> // for std::min
+#include <chrono>    // for writer wakeup interval
+#include <cstring>   // for std::memcmp
+
+TraceWriter::TraceWriter(const std::string &path, const TraceLevel level)
+    : file(std::fopen(path.c_str(), "wb")), ring(capacity) {
+  if (file == nullptr)
+    throw std::runtime_error("cannot open trace file '" + path + "'");
+
+  TraceHeader header{};
+  std::copy(std::begin(trace_magic), std::end(trace_magic), header.magic);
+  header.version = trace_version;
+  header.level = static_cast<std::uint32_t>(level);
+  std::fwrite(&header, sizeof(header), 1, file);
+
+  thread = std::thread(&TraceWriter::run, this);
+}
+
+TraceWriter::~TraceWriter() {
+  done.store(true, std::memory_order_release);
+  wakeup.notify_one();
+  thread.join();
+  std::fclose(file);
+}
+
+void TraceWriter::push(const TraceRecord &record) {
+  const std::size_t h = head.load(std::memory_order_relaxed);
+  // buffer full, let the writer catch up
+  while (h - tail.load(std::memory_order_acquire) == capacity) {
+    wakeup.notify_one();
+    std::this_thread::yield();
+  }
+  ring[h & (capacity - 1)] = record;
+  head.store(h + 1, std::memory_order_release);
+  // waking the writer on every record would cost more than formatting did
+  if (((h + 1) & (capacity / 2 - 1)) == 0)
+    wakeup.notify_one();
+}
+
+void TraceWriter::run() {
+  for (;;) {
+    const std::size_t t = tail.load(std::memory_order_relaxed);
+    const std::size_t h = head.load(std::memory_order_acquire);
+    if (t == h) {
+      // the producer sets done only after its last push
+      if (done.load(std::memory_order_acquire) and head.load(std::memory_order_acquire) == t)
+        break;
+      std::unique_lock<std::mutex> lock(mutex);
+      wakeup.wait_for(lock, std::chrono::milliseconds(1));
+      continue;
+    }
+    // write the longest run that does not wrap around the end of the ring
+    const std::size_t n = std::min(h - t, capacity - (t & (capacity - 1)));
+    std::fwrite(&ring[t & (capacity - 1)], sizeof(TraceRecord), n, file);
+    tail.store(t + n, std::memory_order_release);
+  }
+}
+
+void decodeTrace(const std::string &path, std::ostream &os) {
+  std::unique_ptr<std::FILE, int (*)(std::FILE *)> file(std::fopen(path.c_str(), "rb"),
+                                                       &std::fclose);
+  if (not file)
+    throw std::runtime_error("cannot open trace file '" + path + "'");
+
+  TraceHeader header;
+  if (std::fread(&header, sizeof(header), 1, file.get()) != 1 or
+      std::memcmp(header.magic, trace_magic, sizeof(trace_magic)) != 0)
+    throw std::runtime_error("'" + path + "' is not a trace file");
+  if (header.version != trace_version)
+    throw std::runtime_error("unsupported trace version");
+  const auto level = static_cast<TraceLevel>(header.level);
+
+  // registers are rebuilt from the snapshot at the start of the run and the
+  // deltas recorded for every instruction
+  RegisterFile RF;
+  std::vector<TraceRecord> records(4096);
+  for (std::size_t n; (n = std::fread(records.data(), sizeof(TraceRecord), records.size(),
+                                      file.get())) > 0;) {
+    for (std::size_t i = 0; i < n; ++i) {
+      const TraceRecord &record = records[i];
+      switch (record.kind) {
+      case TraceRecordKind::Instruction: {
+        os << "Program Counter : 0x" << std::hex << record.pc << std::dec << "\n";
+        if (level >= TraceLevel::Full) {
+          if (record.rd != no_of_registers)
+            RF.writeReg(record.rd, record.value);
+          RF.dump(os);
+        }
+        os << "Time taken : " << record.time << "\n\n";
+      } break;
+
+      case TraceRecordKind::Summary: {
+        os << "Total simulation cycles : " << record.time << "\n\n";
+      } break;
+
+      case TraceRecordKind::Register: {
+        if (record.rd >= no_of_registers)
+          throw std::runtime_error("corrupt trace record");
+        RF.writeReg(record.rd, record.value);
+      } break;
+
+      default:
+        throw std::runtime_error("corrupt trace record");
+      }
+    }
+  }
+}
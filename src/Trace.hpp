@@ -0,0 +1,159 @@
+#ifndef __TRACE_H
+#define __TRACE_H
+
+#include "RegisterFile.hpp"
+#include <atomic>             // for ring buffer indices
+#include <condition_variable> // for waking the writer thread
+#include <cstdint>            // for fixed width record fields
+#include <cstdio>             // for std::FILE
+#include <memory>             // for std::unique_ptr
+#include <mutex>              // for std::mutex
+#include <string>
+#include <thread>             // for std::thread
+#include <vector>             // for std::vector
+
+// Each level includes everything the levels before it produce.
+enum class TraceLevel {
+  None,    // no output at all
+  Summary, // total cycles and final memory state
+  PC,      // + PC and time taken of every instruction
+  Full     // + register file after every instruction
+};
+
+// On disk a trace is a header followed by fixed-size records. Full traces
+// start with a Register record per register, since a run restored from a
+// checkpoint does not start from zeroed registers.
+struct TraceHeader {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t level;
+};
+
+enum class TraceRecordKind : std::uint8_t { Instruction, Summary, Register };
+
+struct TraceRecord {
+  // cycles taken by the instruction, or total cycles for a summary
+  std::uint64_t time;
+  Word pc;
+  // value of rd after writeback, only meaningful if rd is a register; for a
+  // Register record the value rd holds
+  Word value;
+  TraceRecordKind kind;
+  // register written by the instruction, no_of_registers if none
+  std::uint8_t rd;
+  std::uint8_t padding[6];
+};
+
+static_assert(sizeof(TraceRecord) == 24, "trace records must have a fixed layout");
+
+constexpr char trace_magic[8] = {'R', 'V', 'T', 'R', 'A', 'C', 'E', '\0'};
+constexpr std::uint32_t trace_version = 2;
+
+// Single-producer ring buffer of trace records, drained to a file by a
+// background thread so the simulation never waits on formatting or I/O
+// unless the buffer is full.
+class TraceWriter final {
+
+  static constexpr std::size_t capacity = 1u << 16;
+
+  std::FILE *file;
+  std::vector<TraceRecord> ring;
+  // head is only written by the producer, tail only by the writer thread
+  std::atomic<std::size_t> head{0}, tail{0};
+  std::atomic<bool> done{false};
+
+  std::mutex mutex;
+  std::condition_variable wakeup;
+  std::thread thread;
+
+  void run();
+
+public:
+  TraceWriter(const std::string &path, const TraceLevel level);
+  ~TraceWriter();
+
+  TraceWriter(const TraceWriter &) = delete;
+  TraceWriter(TraceWriter &&) = delete;
+
+  void push(const TraceRecord &record);
+};
+
+// Front end used by the simulation, it either formats text straight to an
+// output stream or hands binary records to a TraceWriter.
+class Tracer final {
+
+  const TraceLevel level;
+  std::ostream &os;
+  std::unique_ptr<TraceWriter> writer;
+
+public:
+  Tracer(const TraceLevel level_, std::ostream &os_, const std::string &path = "")
+      : level(level_), os(os_) {
+    if (not path.empty() and level > TraceLevel::None)
+      writer = std::make_unique<TraceWriter>(path, level);
+  }
+
+  bool enabled(const TraceLevel l) const { return level >= l; }
+
+  void instructionBegin(const Word PC) {
+    if (level >= TraceLevel::PC and not writer)
+      // dump PC
+      os << "Program Counter : 0x" << std::hex << PC << std::dec << "\n";
+  }
+
+  void instructionEnd(const Word PC, const Cycle t, RegisterFile &RF, const unsigned rd) {
+    if (level < TraceLevel::PC)
+      return;
+    if (writer) {
+      TraceRecord record{};
+      record.time = t;
+      record.pc = PC;
+      record.kind = TraceRecordKind::Instruction;
+      record.rd = no_of_registers;
+      if (level >= TraceLevel::Full and rd != no_of_registers) {
+        record.rd = rd;
+        record.value = RF.getReg(rd);
+      }
+      writer->push(record);
+      return;
+    }
+    // dump registers
+    if (level >= TraceLevel::Full)
+      RF.dump(os);
+    // dump timing
+    os << "Time taken : " << t << "\n\n";
+  }
+
+  // records the whole register file, which the decoder of a binary trace
+  // otherwise only knows the changes of
+  void registers(RegisterFile &RF) {
+    if (not writer or level < TraceLevel::Full)
+      return;
+    for (unsigned i = 0; i < no_of_registers; ++i) {
+      TraceRecord record{};
+      record.kind = TraceRecordKind::Register;
+      record.rd = i;
+      record.value = RF.getReg(i);
+      writer->push(record);
+    }
+  }
+
+  void summary(const Cycle total) {
+    if (level < TraceLevel::Summary)
+      return;
+    if (writer) {
+      TraceRecord record{};
+      record.time = total;
+      record.kind = TraceRecordKind::Summary;
+      record.rd = no_of_registers;
+      writer->push(record);
+    }
+    os << "Total simulation cycles : " << total << "\n\n";
+  }
+};
+
+// Renders a binary trace file in the same text format as the simulator
+// prints when tracing to an output stream.
+void decodeTrace(const std::string &path, std::ostream &os);
+
+#endif /* end of __TRACE_H */
@@ -0,0 +1,18 @@
+/* Renders binary traces written by risc-v-sim --trace-file as text.
+ *
+ */
+#include "Trace.hpp"
+
+int main(int argc, char **argv) {
+  if (argc != 2) {
+    std::cerr << "Usage: risc-v-trace-decode <trace>\n";
+    return 1;
+  }
+
+  try {
+    decodeTrace(argv[1], std::cout);
+  } catch (std::exception &e) {
+    std::cerr << "error: " << e.what() << "\n";
+    return 1;
+  }
+}
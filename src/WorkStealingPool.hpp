@@ -0,0 +1,79 @@
+#ifndef __WORK_STEALING_POOL_H
+#define __WORK_STEALING_POOL_H
+
+#include <algorithm>  // for std::max
+#include <deque>      // for std::deque
+#include <functional> // for std::function
+#include <mutex>      // for std::mutex
+#include <thread>     // for std::thread
+#include <vector>     // for std::vector
+
+// Runs a set of independent tasks on a fixed number of threads. Every worker
+// has its own deque, tasks are dealt to them round-robin, and a worker takes
+// tasks from the back of its own deque and, once that is empty, steals from
+// the front of the others'. Workers thus rarely contend for a lock, and a
+// worker stuck with long tasks has the rest of its share taken over.
+class WorkStealingPool final {
+
+  struct Queue {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  std::vector<Queue> queues;
+  std::size_t next = 0;
+
+  bool pop(const std::size_t worker, std::function<void()> &task) {
+    Queue &own = queues[worker];
+    {
+      std::lock_guard<std::mutex> lock(own.mutex);
+      if (not own.tasks.empty()) {
+        task = std::move(own.tasks.back());
+        own.tasks.pop_back();
+        return true;
+      }
+    }
+    for (std::size_t i = 1; i < queues.size(); ++i) {
+      Queue &victim = queues[(worker + i) % queues.size()];
+      std::lock_guard<std::mutex> lock(victim.mutex);
+      if (not victim.tasks.empty()) {
+        task = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void work(const std::size_t worker) {
+    // tasks never submit tasks, so once every deque is empty the work is done
+    for (std::function<void()> task; pop(worker, task);)
+      task();
+  }
+
+public:
+  // 0 threads means one per hardware thread
+  explicit WorkStealingPool(unsigned threads = 0)
+      : queues(threads ? threads : std::max(1u, std::thread::hardware_concurrency())) {}
+
+  WorkStealingPool(const WorkStealingPool &) = delete;
+  WorkStealingPool(WorkStealingPool &&) = delete;
+
+  // tasks are all submitted before run, not while it runs
+  void submit(std::function<void()> task) {
+    queues[next++ % queues.size()].tasks.push_back(std::move(task));
+  }
+
+  // runs every submitted task, returning once all have finished; tasks must
+  // not throw
+  void run() {
+    std::vector<std::thread> workers;
+    for (std::size_t w = 1; w < queues.size(); ++w)
+      workers.emplace_back(&WorkStealingPool::work, this, w);
+    work(0);
+    for (auto &worker : workers)
+      worker.join();
+  }
+};
+
+#endif /* end of __WORK_STEALING_POOL_H */
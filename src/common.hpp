@@ -1,6 +1,8 @@
 #ifndef __COMMON_H
 #define __COMMON_H
 
+#include <cstddef>  // for std::size_t
+#include <cstdint>  // for fixed width integers
 #include <iomanip>  // for formatting traces
 #include <iostream> // for dumping trace to output stream
 #include <utility>  // for std::pair
@@ -19,4 +21,23 @@ using Instruction = std::uint32_t;
 // 32 registers: r0, r1, ..., r31
 constexpr unsigned no_of_registers = 32;
 
+// non-owning view of contiguous elements, used to move blocks between memory
+// levels without temporary containers
+template <typename T> class Span {
+  T *ptr;
+  std::size_t len;
+
+public:
+  Span(T *ptr_, const std::size_t len_) : ptr(ptr_), len(len_) {}
+
+  T *data() const { return ptr; }
+  std::size_t size() const { return len; }
+  T *begin() const { return ptr; }
+  T *end() const { return ptr + len; }
+  T &operator[](const std::size_t i) const { return ptr[i]; }
+  Span subspan(const std::size_t offset, const std::size_t count) const {
+    return {ptr + offset, count};
+  }
+};
+
 #endif /* end of __COMMON_H */
@@ -0,0 +1,13 @@
+add r5 r10 r10
+add r5 r5 r5
+addi r5 r5 256
+xor r6 r6 r6
+xor r7 r7 r7
+addi r7 r7 100
+loop_start: bge r6 r7 loop_end
+lw r8 0(r5)
+addi r8 r8 1
+sw r8 0(r5)
+addi r6 r6 1
+beq r6 r6 loop_start
+loop_end: xor r9 r9 r9